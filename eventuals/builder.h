@@ -31,6 +31,11 @@ class Field<Value_, true> {
   Field(Value_ value)
     : value_(std::move(value)) {}
 
+  // NOTE: explicitly defaulted because the virtual destructor would
+  // otherwise prevent moving (which is necessary for move-only values).
+  Field(const Field&) = default;
+  Field(Field&&) = default;
+
   virtual ~Field() = default;
 
   auto& value() & {
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
+#include <new>
 #include <type_traits> // For std::aligned_storage.
 #include <utility> // For std::move.
 
@@ -10,17 +12,161 @@ namespace eventuals {
 
 ////////////////////////////////////////////////////////////////////////
 
-// Helper for using lambdas that only capture 'this' or something less
-// than or equal to 'sizeof(void*)' without needing to do any heap
-// allocation or use std::function (which increases compile times and
-// is not required to avoid heap allocation even if most
-// implementations do for small lambdas).
+// Thread local pool of fixed size blocks used for storing callables
+// that are too big to be stored inline in a 'Callback', see 'Pooled()'.
+//
+// Blocks are returned to the pool of the thread that deallocates
+// them, which may be different than the thread that allocated them
+// (e.g., when a callback gets submitted to another thread), so we
+// bound the number of free blocks each thread holds on to.
+struct _CallbackPool final {
+  // Size of the smallest block, each larger block is double the size
+  // of the previous one. Callables that are larger than the largest
+  // block just get allocated with 'new'.
+  static constexpr std::size_t kMinBlockSize = 64;
+  static constexpr std::size_t kBlockSizes = 4;
+
+  // Maximum number of free blocks per block size per thread.
+  static constexpr std::size_t kMaxFreeBlocks = 64;
+
+  struct Block final {
+    Block* next = nullptr;
+  };
+
+  struct FreeList final {
+    ~FreeList() {
+      while (head != nullptr) {
+        Block* block = head;
+        head = head->next;
+        ::operator delete(block);
+      }
+    }
+
+    Block* head = nullptr;
+    std::size_t size = 0;
+  };
+
+  // Returns the index of the smallest block size that fits 'size'
+  // bytes or 'kBlockSizes' if none do.
+  static constexpr std::size_t Index(std::size_t size) {
+    std::size_t index = 0;
+    std::size_t block = kMinBlockSize;
+    while (index < kBlockSizes && block < size) {
+      index++;
+      block *= 2;
+    }
+    return index;
+  }
+
+  static FreeList* List(std::size_t index) {
+    static thread_local FreeList lists[kBlockSizes];
+    return &lists[index];
+  }
+
+  template <std::size_t Size>
+  static void* Allocate() {
+    constexpr std::size_t index = Index(Size);
+    if constexpr (index < kBlockSizes) {
+      FreeList* list = List(index);
+      if (list->head != nullptr) {
+        Block* block = list->head;
+        list->head = block->next;
+        list->size--;
+        block->~Block();
+        return block;
+      }
+      return ::operator new(kMinBlockSize << index);
+    } else {
+      return ::operator new(Size);
+    }
+  }
+
+  template <std::size_t Size>
+  static void Deallocate(void* pointer) {
+    constexpr std::size_t index = Index(Size);
+    if constexpr (index < kBlockSizes) {
+      FreeList* list = List(index);
+      if (list->size < kMaxFreeBlocks) {
+        list->head = new (pointer) Block{list->head};
+        list->size++;
+        return;
+      }
+    }
+    ::operator delete(pointer);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Callable that stores the callable 'F' in a block from
+// '_CallbackPool' so that it's small enough to be stored inline in a
+// 'Callback'.
+template <typename F_>
+struct _PooledCallable final {
+  static_assert(
+      alignof(F_) <= alignof(std::max_align_t),
+      "Pooled callables must not be over aligned");
+
+  _PooledCallable(F_ f)
+    : f_(new (_CallbackPool::Allocate<sizeof(F_)>()) F_(std::move(f))) {}
+
+  _PooledCallable(_PooledCallable&& that)
+    : f_(that.f_) {
+    that.f_ = nullptr;
+  }
+
+  ~_PooledCallable() {
+    if (f_ != nullptr) {
+      f_->~F_();
+      _CallbackPool::Deallocate<sizeof(F_)>(f_);
+    }
+  }
 
-template <typename>
+  template <typename... Args>
+  decltype(auto) operator()(Args&&... args) {
+    return (*f_)(std::forward<Args>(args)...);
+  }
+
+  F_* f_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// See 'Pooled()'.
+template <typename F_>
+struct _Pooled final {
+  F_ f_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Opts in to storing 'f' in a block from a thread local pool when
+// it's too big to be stored inline in a 'Callback' (instead of
+// failing to compile), e.g., for callables that capture an error that
+// needs to be propagated to another thread.
+template <typename F>
+auto Pooled(F f) {
+  return _Pooled<F>{std::move(f)};
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Helper for using lambdas that only capture 'this' or something less
+// than or equal to 'Size' (by default 2 * sizeof(void*)) without
+// needing to do any heap allocation or use std::function (which
+// increases compile times and is not required to avoid heap
+// allocation even if most implementations do for small lambdas).
+//
+// Lambdas that are bigger than 'Size' must either be wrapped with
+// 'Pooled()' or use a 'Callback' with a bigger 'Size'.
+//
+// NOTE: we allow up to 2 * sizeof(void*) by default to accomodate
+// storing a 'stout::borrowed_callable'.
+template <typename, std::size_t Size = 2 * sizeof(void*)>
 struct Callback;
 
-template <typename R, typename... Args>
-struct Callback<R(Args...)> final {
+template <typename R, typename... Args, std::size_t Size_>
+struct Callback<R(Args...), Size_> final {
   // TODO(benh): Delete default constructor and force a usage pattern
   // where a delayed initialization requires std::optional so that a
   // user doesn't run into issues where they try and invoke a callback
@@ -63,17 +209,29 @@ struct Callback<R(Args...)> final {
         !std::is_same_v<Callback, std::decay_t<F>>,
         "Not to be used as a *copy* assignment operator!");
 
-    static_assert(sizeof(Handler<F>) <= SIZE);
+    if constexpr (IsPooled<F>::value) {
+      using G = decltype(f.f_);
+      if constexpr (sizeof(Handler<G>) <= SIZE) {
+        return this->operator=(std::move(f.f_));
+      } else {
+        return this->operator=(_PooledCallable<G>(std::move(f.f_)));
+      }
+    } else {
+      static_assert(
+          sizeof(Handler<F>) <= SIZE,
+          "Callable is too big for 'Callback', either use 'Pooled()' "
+          "or a bigger 'Size'");
 
-    if (base_ != nullptr) {
-      base_->~Base();
-    }
+      if (base_ != nullptr) {
+        base_->~Base();
+      }
 
-    new (&storage_) Handler<F>(std::move(f));
+      new (&storage_) Handler<F>(std::move(f));
 
-    base_ = reinterpret_cast<Handler<F>*>(&storage_);
+      base_ = reinterpret_cast<Handler<F>*>(&storage_);
 
-    return *this;
+      return *this;
+    }
   }
 
   Callback(Callback&& that) {
@@ -128,9 +286,13 @@ struct Callback<R(Args...)> final {
     F f_;
   };
 
-  // NOTE: we allow up to 2 * sizeof(void*) to accomodate storing a
-  // 'stout::borrowed_callable'.
-  static constexpr std::size_t SIZE = (2 * sizeof(void*)) + sizeof(Base);
+  template <typename F>
+  struct IsPooled : std::false_type {};
+
+  template <typename F>
+  struct IsPooled<_Pooled<F>> : std::true_type {};
+
+  static constexpr std::size_t SIZE = Size_ + sizeof(Base);
 
   std::aligned_storage_t<SIZE> storage_;
 
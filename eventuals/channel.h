@@ -0,0 +1,323 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "eventuals/closure.h"
+#include "eventuals/filter.h"
+#include "eventuals/if.h"
+#include "eventuals/just.h"
+#include "eventuals/lock.h"
+#include "eventuals/map.h"
+#include "eventuals/repeat.h"
+#include "eventuals/then.h"
+#include "eventuals/until.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+// What a 'Channel' does when a value gets written while it is full.
+enum class ChannelOverflow {
+  // Wait until a value has been read.
+  Block,
+
+  // Give the value back to the writer, e.g., so that it can shed load.
+  Reject,
+
+  // Keep the value in an (unbounded) overflow queue, protected by a
+  // mutex, until the values before it have been read. The channel
+  // is then only lock-free while it holds no more values than its
+  // capacity, but writers never have to wait.
+  Spill,
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Bounded multiple producer multiple consumer channel. It works like
+// 'Pipe' except that the values are stored in a fixed size ring
+// buffer, which can be written and read without acquiring a lock
+// (unless using 'ChannelOverflow::Spill' and the ring buffer is full).
+// The lock is only used when a reader has to wait for a value (or a
+// writer has to wait for space when using 'ChannelOverflow::Block'),
+// and writers and readers only acquire it to notify a waiter when
+// there is one.
+//
+// The ring buffer is the "bounded MPMC queue" by Dmitry Vyukov: each
+// cell has a sequence number which tells writers and readers whether
+// or not it's their turn to use it.
+template <typename T>
+class Channel final : public Synchronizable {
+ public:
+  // NOTE: 'capacity' gets rounded up to the next power of 2 (and is
+  // at least 2 since a ring buffer with a single cell can't tell
+  // whether that cell has been written or read).
+  Channel(
+      size_t capacity,
+      ChannelOverflow overflow = ChannelOverflow::Block)
+    : has_values_or_closed_(&lock()),
+      has_space_or_closed_(&lock()),
+      overflow_(overflow) {
+    CHECK_GT(capacity, 0u);
+
+    size_t size = 2;
+    while (size < capacity) {
+      size *= 2;
+    }
+
+    cells_ = std::make_unique<Cell[]>(size);
+
+    for (size_t i = 0; i < size; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    mask_ = size - 1;
+  }
+
+  ~Channel() override = default;
+
+  // Returns an eventual that writes 'value' and then propagates an
+  // empty optional, or 'value' if the channel is full and overflow is
+  // 'ChannelOverflow::Reject'. Like 'Pipe', any values written after
+  // the channel has been closed are dropped.
+  auto Write(T&& value) {
+    return Closure([this,
+                    value = std::make_optional(std::move(value))]() mutable {
+      return Then([this, &value]() {
+               return If(!TryWriteOrDrop(value)
+                         && overflow_ == ChannelOverflow::Block)
+                   .yes(Synchronized(
+                       Then([this, &value]() {
+                         writers_waiting_.fetch_add(1);
+                         return has_space_or_closed_.Wait([this, &value]() {
+                           std::atomic_thread_fence(std::memory_order_seq_cst);
+                           return !TryWriteOrDrop(value);
+                         });
+                       })
+                       | Then([this]() {
+                           writers_waiting_.fetch_sub(1);
+                         })))
+                   .no(Just());
+             })
+          | Then([this]() {
+               return Notify(readers_waiting_, has_values_or_closed_);
+             })
+          | Then([&value]() {
+               return std::move(value);
+             });
+    });
+  }
+
+  auto Read() {
+    return Repeat()
+        | Map([this]() {
+             return Closure([this, value = std::optional<T>()]() mutable {
+               return Then([this, &value]() {
+                        value = TryRead();
+                        return If(value.has_value() || closed_.load())
+                            .yes(Just())
+                            .no(Synchronized(
+                                Then([this, &value]() {
+                                  readers_waiting_.fetch_add(1);
+                                  return has_values_or_closed_.Wait(
+                                      [this, &value]() {
+                                        std::atomic_thread_fence(
+                                            std::memory_order_seq_cst);
+                                        value = TryRead();
+                                        return !value.has_value()
+                                            && !closed_.load();
+                                      });
+                                })
+                                | Then([this]() {
+                                    readers_waiting_.fetch_sub(1);
+                                  })));
+                      })
+                   | Then([this]() {
+                        return Notify(writers_waiting_, has_space_or_closed_);
+                      })
+                   | Then([&value]() {
+                        return std::move(value);
+                      });
+             });
+           })
+        // NOTE: a value might have been written concurrently with
+        // closing the channel, so we only stop once it's empty.
+        | Until([this](auto& value) {
+             return !value.has_value() && closed_.load() && !HasValue();
+           })
+        | Filter([](const auto& value) {
+             return value.has_value();
+           })
+        | Map([](auto&& value) {
+             return std::move(*value);
+           });
+  }
+
+  auto Close() {
+    return Synchronized(Then([this]() {
+      closed_.store(true);
+      has_values_or_closed_.NotifyAll();
+      has_space_or_closed_.NotifyAll();
+    }));
+  }
+
+  size_t capacity() const {
+    return mask_ + 1;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    std::optional<T> value;
+  };
+
+  // Writes 'value' if there is space and returns true, or returns
+  // false if the channel is full. Like 'Pipe', if the channel is
+  // closed 'value' gets dropped and we return true.
+  bool TryWriteOrDrop(std::optional<T>& value) {
+    if (closed_.load()) {
+      value.reset();
+      return true;
+    }
+
+    // NOTE: once we've spilled values every value has to be spilled
+    // until they've all been read so that values are read in order.
+    if (overflow_ == ChannelOverflow::Spill && spilled_.load() > 0) {
+      Spill(value);
+      return true;
+    }
+
+    size_t position = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[position & mask_];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+      if (difference == 0) {
+        if (tail_.compare_exchange_weak(
+                position,
+                position + 1,
+                std::memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.sequence.store(position + 1, std::memory_order_release);
+          value.reset();
+          return true;
+        }
+      } else if (difference < 0) {
+        if (overflow_ == ChannelOverflow::Spill) {
+          Spill(value);
+          return true;
+        } else {
+          return false;
+        }
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns a value if the channel has one, or an empty optional.
+  std::optional<T> TryRead() {
+    size_t position = head_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[position & mask_];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+      if (difference == 0) {
+        if (head_.compare_exchange_weak(
+                position,
+                position + 1,
+                std::memory_order_relaxed)) {
+          std::optional<T> value = std::move(cell.value);
+          cell.value.reset();
+          cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+          return value;
+        }
+      } else if (difference < 0) {
+        return Unspill();
+      } else {
+        position = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool HasValue() {
+    size_t position = head_.load(std::memory_order_relaxed);
+    return cells_[position & mask_].sequence.load(std::memory_order_acquire)
+        == position + 1
+        || spilled_.load() > 0;
+  }
+
+  // Moves 'value' into the overflow queue, see 'ChannelOverflow::Spill'.
+  void Spill(std::optional<T>& value) {
+    std::lock_guard<std::mutex> lock(spill_mutex_);
+    spill_.push_back(std::move(*value));
+    spilled_.fetch_add(1);
+    value.reset();
+  }
+
+  // Returns the oldest value from the overflow queue, if any.
+  std::optional<T> Unspill() {
+    if (spilled_.load() == 0) {
+      return std::nullopt;
+    } else {
+      std::lock_guard<std::mutex> lock(spill_mutex_);
+      if (spill_.empty()) {
+        return std::nullopt;
+      } else {
+        std::optional<T> value = std::move(spill_.front());
+        spill_.pop_front();
+        spilled_.fetch_sub(1);
+        return value;
+      }
+    }
+  }
+
+  // Notifies a waiter, if there is one.
+  //
+  // NOTE: waiters increment 'waiting' before they check the channel
+  // (and we check 'waiting' after updating the channel), with a fence
+  // in between on both sides, so either they'll see our update or we
+  // will see them waiting.
+  auto Notify(std::atomic<size_t>& waiting, ConditionVariable& condition) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return If(waiting.load() > 0)
+        .yes(Synchronized(Then([&condition]() {
+          condition.Notify();
+        })))
+        .no(Just());
+  }
+
+  ConditionVariable has_values_or_closed_;
+  ConditionVariable has_space_or_closed_;
+
+  const ChannelOverflow overflow_;
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_ = 0;
+
+  std::atomic<size_t> head_ = 0;
+  std::atomic<size_t> tail_ = 0;
+
+  // Values that didn't fit when using 'ChannelOverflow::Spill'.
+  std::mutex spill_mutex_;
+  std::deque<T> spill_;
+  std::atomic<size_t> spilled_ = 0;
+
+  std::atomic<size_t> readers_waiting_ = 0;
+  std::atomic<size_t> writers_waiting_ = 0;
+
+  std::atomic<bool> closed_ = false;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -1,10 +1,14 @@
 #pragma once
 
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <optional>
 #include <tuple>
+#include <vector>
 
 #include "eventuals/callback.h"
+#include "eventuals/closure.h"
 #include "eventuals/compose.h"
 #include "eventuals/concurrent.h"
 #include "eventuals/flat-map.h"
@@ -23,8 +27,9 @@ namespace eventuals {
 struct _ReorderAdaptor final {
   template <typename K_, typename Value_>
   struct Continuation final : public TypeErasedStream {
-    Continuation(K_ k)
-      : k_(std::move(k)) {}
+    Continuation(K_ k, std::atomic<int>* window)
+      : window_(window),
+        k_(std::move(k)) {}
 
     Continuation(Continuation&& that) = default;
 
@@ -42,14 +47,14 @@ struct _ReorderAdaptor final {
       CHECK(!done_);
       int i = std::get<0>(tuple);
       if (i < 0) {
-        ended_[i * -1] = true;
+        Lookup(i * -1).ended = true;
         Next();
       } else if (index_ == i) {
-        CHECK(buffer_[i].empty());
+        CHECK(Lookup(i).Empty());
         k_.Body(std::move(std::get<1>(tuple).value()));
       } else {
         CHECK(index_ < i);
-        buffer_[i].push_back(std::move(std::get<1>(tuple).value()));
+        Lookup(i).values.push_back(std::move(std::get<1>(tuple).value()));
         upstream_->Next();
       }
     }
@@ -74,13 +79,15 @@ struct _ReorderAdaptor final {
     // Calls 'Next' on 'upstream' in case when there are no stored
     // values, propagate a value from buffer to 'Body' otherwise.
     void Next() override {
-      if (!buffer_[index_].empty()) {
-        auto value = buffer_[index_].front();
-        buffer_[index_].pop_front();
+      Slot& slot = Lookup(index_);
+      if (!slot.Empty()) {
+        auto value = std::move(slot.values[slot.head++]);
         k_.Body(std::move(value));
-      } else if (ended_[index_]) {
-        CHECK(buffer_[index_].empty());
+      } else if (slot.ended) {
         index_++;
+        if (window_ != nullptr) {
+          window_->store(index_, std::memory_order_release);
+        }
         Next();
       } else {
         upstream_->Next();
@@ -89,18 +96,89 @@ struct _ReorderAdaptor final {
 
     void Done() override {
       done_ = true;
-      buffer_.clear();
-      ended_.clear();
+      slots_.clear();
       upstream_->Done();
     }
 
+    // Values (and whether or not all of them have been received) for
+    // a single index, i.e., the values emitted from a single fiber.
+    //
+    // NOTE: we use a 'std::vector' and a 'head' rather than a
+    // 'std::deque' so that a slot can be reused for a later index
+    // without deallocating (and then reallocating) its storage.
+    struct Slot final {
+      bool Empty() const {
+        return head == values.size();
+      }
+
+      void Reset(int i) {
+        index = i;
+        values.clear();
+        head = 0;
+        ended = false;
+      }
+
+      // Index this slot is currently being used for, or an index less
+      // than 'index_' if it isn't being used.
+      int index = 0;
+      std::vector<Value_> values;
+      size_t head = 0;
+      bool ended = false;
+    };
+
+    // Returns the slot for index 'i' from our window of slots, i.e.,
+    // 'slots_[i % slots_.size()]', growing the window if 'i' doesn't
+    // fit. Since 'i' is always within '[index_, index_ + slots_.size())'
+    // any slot with a different index must be for an index that we've
+    // already propagated and can be reused.
+    Slot& Lookup(int i) {
+      CHECK_GE(i, index_);
+
+      if (static_cast<size_t>(i - index_) >= slots_.size()) {
+        Grow(i);
+      }
+
+      Slot& slot = slots_[static_cast<size_t>(i) & (slots_.size() - 1)];
+
+      if (slot.index != i) {
+        CHECK_LT(slot.index, index_);
+        slot.Reset(i);
+      }
+
+      return slot;
+    }
+
+    // Grows the window (keeping its size a power of 2) so that it
+    // includes index 'i', moving all of the slots still in use.
+    void Grow(int i) {
+      size_t size = std::max<size_t>(slots_.size(), kInitialWindow);
+      while (static_cast<size_t>(i - index_) >= size) {
+        size *= 2;
+      }
+
+      std::vector<Slot> slots(size);
+
+      for (Slot& slot : slots_) {
+        if (slot.index >= index_) {
+          slots[static_cast<size_t>(slot.index) & (size - 1)] =
+              std::move(slot);
+        }
+      }
+
+      slots_ = std::move(slots);
+    }
+
+    static constexpr size_t kInitialWindow = 16;
+
     TypeErasedStream* upstream_ = nullptr;
 
-    std::map<int, std::deque<Value_>> buffer_;
+    std::vector<Slot> slots_;
 
     int index_ = 1;
 
-    std::map<int, bool> ended_;
+    // Where we publish 'index_' for 'Concurrent()', if anywhere, see
+    // 'ConcurrentOrdered(n, f)'.
+    std::atomic<int>* window_ = nullptr;
 
     bool done_ = false;
 
@@ -125,15 +203,19 @@ struct _ReorderAdaptor final {
     auto k(K k) && {
       return Continuation<
           K,
-          typename std::tuple_element<1, Arg>::type::value_type>(std::move(k));
+          typename std::tuple_element<1, Arg>::type::value_type>(
+          std::move(k),
+          window_);
     }
+
+    std::atomic<int>* window_ = nullptr;
   };
 };
 
 /////////////////////////////////////////////////////////////////////
 
-inline auto ReorderAdaptor() {
-  return _ReorderAdaptor::Composable{};
+inline auto ReorderAdaptor(std::atomic<int>* window = nullptr) {
+  return _ReorderAdaptor::Composable{window};
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -240,30 +322,74 @@ inline auto ConcurrentOrderedAdaptor() {
 
 /////////////////////////////////////////////////////////////////////
 
+// Index of the next value that 'ReorderAdaptor()' will propagate
+// downstream, shared with 'Concurrent()' so that it doesn't start a
+// fiber for a value that is too far ahead, see 'ConcurrentOrdered(n, f)'.
+//
+// NOTE: explicit move-constructor because of 'std::atomic', which is
+// only ever moved before the eventual has been started.
+struct _ConcurrentOrderedWindow final {
+  _ConcurrentOrderedWindow() = default;
+
+  _ConcurrentOrderedWindow(_ConcurrentOrderedWindow&& that)
+    : index(that.index.load()) {}
+
+  std::atomic<int> index = 1;
+};
+
+/////////////////////////////////////////////////////////////////////
+
+// Like 'ConcurrentOrdered(f)' except at most 'n' fibers will be
+// active at a time, see 'Concurrent(n, f)'.
+//
+// Values that are emitted out of order get buffered (in the window
+// of 'ReorderAdaptor()') until all of the values before them have
+// been emitted. So that one slow fiber can't cause that buffer to
+// grow without bound we don't start a fiber for the value at index
+// 'i' until 'i' is less than 'n' past the index of the next value
+// to be emitted in order, thus at most 'n' values are buffered (for
+// an 'f' that emits one value for each upstream value).
+template <typename F>
+inline auto ConcurrentOrdered(size_t n, F f) {
+  CHECK_GT(n, 0u) << "ConcurrentOrdered expects at least 1 fiber";
+
+  return Closure([n,
+                  f = std::move(f),
+                  window = _ConcurrentOrderedWindow()]() mutable {
+    // NOTE: we call '_Concurrent::Composable' directly (rather than
+    // 'Concurrent(n, f)') so that we can share our window with it.
+    auto g = [f = std::move(f)]() {
+      return FlatMap([&f, j = 1](auto&& tuple) mutable {
+        j = std::get<0>(tuple);
+        return Iterate({std::move(std::get<1>(tuple))})
+            | f()
+            | Map([j](auto&& value) {
+                 return std::make_tuple(j, std::move(value));
+               })
+            // A special 'ConcurrentOrderedAdaptor()' allows us to handle
+            // the case when 'f()' has ended so we can propagate down to
+            // 'ReorderAdaptor()' that all elements for the 'i'th tranche
+            // of values has been emitted.
+            | ConcurrentOrderedAdaptor();
+      });
+    };
+
+    // NOTE: Starting our index 'i' at 1 because we signal the end of that
+    // tranche of values via '-i' which means we can't start at 0.
+    return Map([i = 1](auto&& value) mutable {
+             return std::make_tuple(i++, std::forward<decltype(value)>(value));
+           })
+        | _Concurrent::Composable<decltype(g)>{std::move(g), n, &window.index}
+        // Handles the reordering of values by the propagated indexes.
+        | ReorderAdaptor(&window.index);
+  });
+}
+
+/////////////////////////////////////////////////////////////////////
+
 template <typename F>
 inline auto ConcurrentOrdered(F f) {
-  // NOTE: Starting our index 'i' at 1 because we signal the end of that
-  // tranche of values via '-i' which means we can't start at 0.
-  return Map([i = 1](auto&& value) mutable {
-           return std::make_tuple(i++, std::forward<decltype(value)>(value));
-         })
-      | Concurrent([f = std::move(f)]() {
-           return FlatMap([&f, j = 1](auto&& tuple) mutable {
-             j = std::get<0>(tuple);
-             return Iterate({std::move(std::get<1>(tuple))})
-                 | f()
-                 | Map([j](auto&& value) {
-                      return std::make_tuple(j, std::move(value));
-                    })
-                 // A special 'ConcurrentOrderedAdaptor()' allows us to handle
-                 // the case when 'f()' has ended so we can propagate down to
-                 // 'ReorderAdaptor()' that all elements for the 'i'th tranche
-                 // of values has been emitted.
-                 | ConcurrentOrderedAdaptor();
-           });
-         })
-      // Handles the reordering of values by the propagated indexes.
-      | ReorderAdaptor();
+  return ConcurrentOrdered(std::numeric_limits<size_t>::max(), std::move(f));
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <deque>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <vector>
 
 #include "eventuals/iterate.h"
 #include "eventuals/let.h"
@@ -47,6 +53,15 @@ namespace eventuals {
 template <typename F>
 auto Concurrent(F f);
 
+// Like 'Concurrent(f)' except at most 'n' fibers will be active at a
+// time and at most 'n' values emitted from the fibers will be
+// buffered waiting for downstream. Once either limit is reached we
+// stop requesting the next upstream value until a fiber completes or
+// downstream takes a value, thus bounding memory and propagating
+// downstream backpressure upstream.
+template <typename F>
+auto Concurrent(size_t n, F f);
+
 ////////////////////////////////////////////////////////////////////////
 
 struct _Concurrent final {
@@ -63,12 +78,10 @@ struct _Concurrent final {
     // continuation is stored in 'Adaptor::Fiber' below because it
     // requires template types.
     //
-    // Each fiber is part of a linked list of fibers that gets pruned
-    // or appended to during runtime as new fibers are needed. We use
-    // a linked list rather than an existing collection because it
-    // nicely matches our algorithm for being able to reuse fibers
-    // that have completed but haven't yet been pruned (see
-    // 'CreateOrReuseFiber()').
+    // Fibers are allocated in slabs (see 'TypeErasedSlab') and never
+    // deallocated until the adaptor is, instead fibers that are done
+    // get put on an intrusive free list so that they can be reused
+    // without any allocation (see 'CreateOrReuseFiber()').
     struct TypeErasedFiber {
       void Reuse() {
         done = false;
@@ -82,27 +95,129 @@ struct _Concurrent final {
       virtual ~TypeErasedFiber() = default;
 
       // A fiber indicates it is done with this boolean.
-      bool done = false;
+      //
+      // NOTE: fibers that have never been started are done.
+      bool done = true;
 
       // Each fiber has it's own interrupt so that we can control how
       // interrupts are propagated.
       class Interrupt interrupt;
 
-      // Each fiber forms a linked list of currently created fibers.
-      std::unique_ptr<TypeErasedFiber> next;
+      // Next fiber on the free list if this fiber is done.
+      TypeErasedFiber* next = nullptr;
 
       // Need to store a cloned context in which would be stored callback.
       std::optional<Scheduler::Context> context;
     };
 
-    // Returns the fiber created from the templated class 'Adaptor'
-    // which actually instantiates a 'Fiber' which has template types.
+    // 'TypeErasedSlab' is a contiguous allocation of fibers, created
+    // from the templated class 'Adaptor' which actually instantiates
+    // 'Fiber's which have template types.
+    struct TypeErasedSlab {
+      virtual ~TypeErasedSlab() = default;
+
+      virtual TypeErasedFiber* fiber(size_t i) = 0;
+    };
+
+    // Returns a slab of 'size' fibers.
     //
     // This virtual method enables 'CreateOrReuseFiber()' to be
     // defined in 'TypeErasedAdaptor' so that it doesn't have to be
     // instantiated for every 'Adaptor' (and we pay a small runtime
     // hit of having to make a virtual function call).
-    virtual TypeErasedFiber* CreateFiber() = 0;
+    virtual std::unique_ptr<TypeErasedSlab> CreateSlab(size_t size) = 0;
+
+    // Allocates another slab of fibers and puts them on the free
+    // list. Slabs double in size (starting at 'kInitialSlab') but we
+    // never allocate more fibers than our limit.
+    //
+    // NOTE: expects to be called while holding the lock associated
+    // with this instance (i.e., to be called from within
+    // 'Synchronized()').
+    void AllocateFibers() {
+      CHECK(lock().OwnedByCurrentSchedulerContext());
+      CHECK_LT(fibers_.size(), limit_);
+
+      size_t size = std::min(
+          limit_ - fibers_.size(),
+          std::max(fibers_.size(), kInitialSlab));
+
+      slabs_.push_back(CreateSlab(size));
+
+      for (size_t i = 0; i < size; i++) {
+        fibers_.push_back(slabs_.back()->fiber(i));
+      }
+
+      // NOTE: pushing onto the free list in reverse so that fibers
+      // get used (and thus interrupted, see 'InterruptFibers()') in
+      // the order they were allocated.
+      for (size_t i = size; i > 0; i--) {
+        TypeErasedFiber* fiber = slabs_.back()->fiber(i - 1);
+        fiber->next = free_;
+        free_ = fiber;
+      }
+    }
+
+    // Returns the number of values emitted from fibers that are
+    // waiting to be moved downstream.
+    //
+    // NOTE: virtual for the same reasons as 'CreateFiber()'.
+    virtual size_t Buffered() = 0;
+
+    // Returns true if we should wait to request the next upstream
+    // value because we've reached our limit of active fibers or
+    // buffered values (unless we're done, interrupted, or have
+    // failed in which case we shouldn't wait at all).
+    //
+    // NOTE: expects to be called while holding the lock associated
+    // with this instance (i.e., to be called from within
+    // 'Synchronized()').
+    bool IngressFull() {
+      CHECK(lock().OwnedByCurrentSchedulerContext());
+      if (downstream_done_ || interrupted_ || exception_) {
+        return false;
+      } else {
+        return active_ >= limit_ || Buffered() >= limit_ || WindowFull();
+      }
+    }
+
+    // Returns true if starting a fiber for the next upstream value
+    // would go beyond the reorder window of 'ConcurrentOrdered(n, f)',
+    // i.e., if the next value's index is 'limit_' or more past the
+    // index of the next value to be propagated downstream in order.
+    //
+    // NOTE: the fiber for the value that is next in order has always
+    // been started (or is done) while the window is full so waiting
+    // can't deadlock.
+    bool WindowFull() {
+      if (ordered_ == nullptr) {
+        return false;
+      } else {
+        // NOTE: the index of the next value to propagate downstream
+        // is never negative nor past the number of values we've
+        // started so we can do all the arithmetic in 'size_t'.
+        size_t next = started_ + 1;
+        size_t index = static_cast<size_t>(
+            ordered_->load(std::memory_order_acquire));
+        CHECK_LE(index, next);
+        return next - index >= limit_;
+      }
+    }
+
+    // Notifies ingress, if it's waiting, that it might be able to
+    // request the next upstream value.
+    //
+    // NOTE: expects to be called while holding the lock associated
+    // with this instance (i.e., to be called from within
+    // 'Synchronized()').
+    void NotifyIngress() {
+      CHECK(lock().OwnedByCurrentSchedulerContext());
+      // NOTE: ingress might not have started yet, e.g., if
+      // downstream is done or we're interrupted before it started.
+      if (notify_ingress_) {
+        notify_ingress_();
+      }
+    }
 
     // Returns true if all fibers are done.
     //
@@ -111,16 +226,7 @@ struct _Concurrent final {
     // 'Synchronized()').
     bool FibersDone() {
       CHECK(lock().OwnedByCurrentSchedulerContext());
-      bool done = true;
-      TypeErasedFiber* fiber = fibers_.get();
-      while (fiber != nullptr) {
-        if (!fiber->done) {
-          done = false;
-          break;
-        }
-        fiber = fiber->next.get();
-      }
-      return done;
+      return active_ == 0;
     }
 
     // Returns true if a fiber had to be interrupted (i.e., not all
@@ -132,22 +238,21 @@ struct _Concurrent final {
     bool InterruptFibers() {
       CHECK(lock().OwnedByCurrentSchedulerContext());
       bool interrupted = false;
-      TypeErasedFiber* fiber = fibers_.get();
-      while (fiber != nullptr) {
+      for (TypeErasedFiber* fiber : fibers_) {
         if (!fiber->done) {
           fiber->interrupt.Trigger();
           interrupted = true;
         }
-        fiber = fiber->next.get();
       }
       return interrupted;
     }
 
     // Returns an eventual which will either create a new fiber or
-    // reuse an existing one and return that fiber. The eventual
-    // returns nullptr to indicate to downstream eventuals that we've
-    // encountered a failure or been interrupted and they should not
-    // continue.
+    // reuse an existing one and return that fiber, first waiting
+    // until we're below our limits (see 'IngressFull()'). The
+    // eventual returns nullptr to indicate to downstream eventuals
+    // that we've encountered a failure or been interrupted and they
+    // should not continue.
     //
     // At somepoint we could use a 'Task' and move this implementation
     // into a .cc file and update the funciton signature to be:
@@ -159,50 +264,40 @@ struct _Concurrent final {
     // further speed ups that are beyond what we get already from
     // putting all of these in 'TypeErasedAdaptor'.
     auto CreateOrReuseFiber() {
-      return Synchronized(Then([this]() {
-        // As long as downstream isn't done, or we've been interrupted,
-        // or have encountered an error, then add a new fiber if none
-        // exist, otherwise trim done fibers from the front, then look
-        // for a done fiber to reuse, or if all fibers are not done add
-        // a new one.
-        TypeErasedFiber* fiber = nullptr;
-
-        if (!(downstream_done_ || interrupted_ || exception_)) {
-          do {
-            if (!fibers_) {
-              fibers_.reset(CreateFiber());
-              fiber = fibers_.get();
-            } else if (fibers_->done) {
-              // Need to release next before we reset so it
-              // doesn't get deallocated as part of reset.
-              fibers_.reset(fibers_->next.release());
-            } else {
-              fiber = fibers_.get();
-              CHECK_NOTNULL(fiber);
-              for (;;) {
-                if (fiber->done) {
-                  fiber->Reuse();
-                  break;
-                } else if (!fiber->next) {
-                  fiber->next.reset(CreateFiber());
-                  fiber = fiber->next.get();
-                  break;
-                } else {
-                  fiber = fiber->next.get();
+      return Synchronized(
+          Wait([this](auto notify) {
+            notify_ingress_ = std::move(notify);
+            return [this]() {
+              return IngressFull();
+            };
+          })
+          | Then([this]() {
+              // As long as downstream isn't done, or we've been interrupted,
+              // or have encountered an error, then take a fiber from the
+              // free list, allocating more fibers if the list is empty.
+              TypeErasedFiber* fiber = nullptr;
+
+              if (!(downstream_done_ || interrupted_ || exception_)) {
+                if (free_ == nullptr) {
+                  AllocateFibers();
                 }
-              }
-              CHECK_NOTNULL(fiber);
-            }
-          } while (fiber == nullptr);
 
-          CHECK_NOTNULL(fiber);
+                fiber = CHECK_NOTNULL(free_);
+                free_ = fiber->next;
+                fiber->next = nullptr;
 
-          // Mark fibers not done since we're starting one.
-          fibers_done_ = false;
-        }
+                CHECK(fiber->done);
+                fiber->Reuse();
 
-        return fiber;
-      }));
+                // Mark fibers not done since we're starting one.
+                fibers_done_ = false;
+
+                active_++;
+                started_++;
+              }
+
+              return fiber;
+            }));
     }
 
     // Returns an eventual to handle when the upstream stream has
@@ -276,6 +371,12 @@ struct _Concurrent final {
               .start([this, fiber](auto& k) {
                 fiber->done = true;
 
+                active_--;
+
+                fiber->next = free_;
+                free_ = fiber;
+                NotifyIngress();
+
                 fibers_done_ = FibersDone();
 
                 if (upstream_done_ && fibers_done_) {
@@ -288,6 +389,11 @@ struct _Concurrent final {
               .fail([this, fiber](auto& k, auto&& error) {
                 fiber->done = true;
 
+                active_--;
+
+                fiber->next = free_;
+                free_ = fiber;
+
                 if (!exception_) {
                   exception_ = make_exception_ptr_or_forward(
                       std::forward<decltype(error)>(error));
@@ -295,6 +401,8 @@ struct _Concurrent final {
 
                 fibers_done_ = !InterruptFibers();
 
+                NotifyIngress();
+
                 if (upstream_done_ && fibers_done_) {
                   notify_egress_();
                   notify_done_();
@@ -305,6 +413,11 @@ struct _Concurrent final {
               .stop([this, fiber](auto& k) {
                 fiber->done = true;
 
+                active_--;
+
+                fiber->next = free_;
+                free_ = fiber;
+
                 if (!exception_) {
                   exception_ = std::make_exception_ptr(
                       eventuals::StoppedException());
@@ -312,6 +425,8 @@ struct _Concurrent final {
 
                 fibers_done_ = !InterruptFibers();
 
+                NotifyIngress();
+
                 if (upstream_done_ && fibers_done_) {
                   notify_egress_();
                   notify_done_();
@@ -332,6 +447,8 @@ struct _Concurrent final {
 
                fibers_done_ = !InterruptFibers();
 
+               NotifyIngress();
+
                if (upstream_done_ && fibers_done_) {
                  notify_egress_();
                  notify_done_();
@@ -377,6 +494,8 @@ struct _Concurrent final {
 
                fibers_done_ = !InterruptFibers();
 
+               NotifyIngress();
+
                if (upstream_done_ && fibers_done_) {
                  notify_done_();
                }
@@ -401,13 +520,43 @@ struct _Concurrent final {
           | Terminal();
     }
 
-    // Head of linked list of fibers.
-    std::unique_ptr<TypeErasedFiber> fibers_;
+    // Size of the first slab of fibers, see 'AllocateFibers()'.
+    static constexpr size_t kInitialSlab = 16;
+
+    // All of the fibers we've allocated and the slabs they were
+    // allocated from.
+    std::vector<TypeErasedFiber*> fibers_;
+    std::vector<std::unique_ptr<TypeErasedSlab>> slabs_;
+
+    // Head of the intrusive list of fibers that are done and can be
+    // reused.
+    TypeErasedFiber* free_ = nullptr;
 
     // Callback associated with waiting for "egress", i.e., values
     // from each fiber.
     Callback<void()> notify_egress_;
 
+    // Callback associated with waiting for "ingress", i.e., for
+    // being able to request the next upstream value.
+    Callback<void()> notify_ingress_;
+
+    // Maximum number of active fibers and buffered values, see
+    // 'Concurrent(n, f)'.
+    size_t limit_ = std::numeric_limits<size_t>::max();
+
+    // Number of fibers that have been started but not yet completed.
+    size_t active_ = 0;
+
+    // Number of fibers that have ever been started.
+    size_t started_ = 0;
+
+    // Index of the next value that 'ReorderAdaptor()' will propagate
+    // downstream when used from 'ConcurrentOrdered(n, f)', otherwise
+    // nullptr, see 'WindowFull()'.
+    //
+    // NOTE: written without holding our lock, hence atomic.
+    std::atomic<int>* ordered_ = nullptr;
+
     bool upstream_done_ = false;
     bool downstream_done_ = false;
     bool fibers_done_ = false;
@@ -429,8 +578,11 @@ struct _Concurrent final {
   // uses in order to implement the semantics of 'Concurrent()'.
   template <typename F_, typename Arg_>
   struct Adaptor final : TypeErasedAdaptor {
-    Adaptor(F_ f)
-      : f_(std::move(f)) {}
+    Adaptor(F_ f, size_t limit, std::atomic<int>* ordered)
+      : f_(std::move(f)) {
+      limit_ = limit;
+      ordered_ = ordered;
+    }
 
     ~Adaptor() override = default;
 
@@ -461,10 +613,27 @@ struct _Concurrent final {
           | Terminal();
     }
 
-    // Returns an upcasted 'TypeErasedFiber' from our typeful 'Fiber'.
-    TypeErasedFiber* CreateFiber() override {
+    // Our typeful slab of fibers.
+    template <typename E_>
+    struct Slab final : TypeErasedSlab {
+      explicit Slab(size_t size)
+        : fibers(size) {}
+
+      TypeErasedFiber* fiber(size_t i) override {
+        return &fibers[i];
+      }
+
+      std::vector<Fiber<E_>> fibers;
+    };
+
+    // Returns an upcasted 'TypeErasedSlab' from our typeful 'Slab'.
+    std::unique_ptr<TypeErasedSlab> CreateSlab(size_t size) override {
       using E = decltype(FiberEventual(nullptr, std::declval<Arg_>()));
-      return new Fiber<E>();
+      return std::make_unique<Slab<E>>(size);
+    }
+
+    size_t Buffered() override {
+      return values_.size();
     }
 
     // Helper that starts a fiber by downcasting to typeful fiber.
@@ -474,10 +643,24 @@ struct _Concurrent final {
       static_cast<Fiber<E>*>(fiber)->k.emplace(
           Build(FiberEventual(fiber, std::move(arg))));
 
+      // NOTE: we only compute the name for our fibers once, the
+      // first time we start a fiber, rather than every time, and
+      // then have each fiber's context borrow it rather than copy it
+      // (which would allocate per fiber). This is safe because the
+      // fibers never outlive us. We don't intern it because the name
+      // of the parent context might not come from a bounded set (see
+      // 'StaticName::Intern()').
+      //
       // TODO(benh): differentiate the names of the fibers for
       // easier debugging!
+      if (!fiber_name_) {
+        fiber_name_ = std::string(Scheduler::Context::Get()->name())
+            + " [concurrent fiber]";
+      }
+
       fiber->context.emplace(
-          Scheduler::Context::Get()->name() + " [concurrent fiber]");
+          std::string_view(*fiber_name_),
+          Scheduler::Context::Borrowed());
 
       fiber->context->scheduler()->Submit(
           [fiber]() {
@@ -519,6 +702,14 @@ struct _Concurrent final {
                  Wait([this](auto notify) {
                    notify_egress_ = std::move(notify);
                    return [this]() {
+                     // NOTE: downstream asking for the next value
+                     // might mean the window of 'ConcurrentOrdered()'
+                     // has moved (which happens without holding our
+                     // lock) so ingress might no longer be full.
+                     if (ordered_ != nullptr) {
+                       NotifyIngress();
+                     }
+
                      if (values_.empty()) {
                        return !(upstream_done_ && fibers_done_);
                      } else {
@@ -544,6 +735,7 @@ struct _Concurrent final {
                            } else if (!values_.empty()) {
                              auto value = std::move(values_.front());
                              values_.pop_front();
+                             NotifyIngress();
                              k.Start(std::optional<Value_>(std::move(value)));
                            } else {
                              CHECK(upstream_done_ && fibers_done_);
@@ -562,6 +754,9 @@ struct _Concurrent final {
 
     F_ f_;
 
+    // Name used for the scheduler context of each fiber.
+    std::optional<std::string> fiber_name_;
+
     using Value_ = typename decltype(f_())::template ValueFrom<Arg_>;
     std::deque<Value_> values_;
   };
@@ -576,13 +771,16 @@ struct _Concurrent final {
   template <typename K_, typename F_, typename Arg_>
   struct Continuation final : public TypeErasedStream {
     // NOTE: explicit constructor because inheriting 'TypeErasedStream'.
-    Continuation(K_ k, F_ f)
-      : adaptor_(std::move(f)),
+    Continuation(K_ k, F_ f, size_t limit, std::atomic<int>* ordered)
+      : adaptor_(std::move(f), limit, ordered),
         k_(std::move(k)) {}
 
     // NOTE: explicit move-constructor because of 'std::atomic_flag'.
     Continuation(Continuation&& that)
-      : adaptor_(std::move(that.adaptor_.f_)),
+      : adaptor_(
+          std::move(that.adaptor_.f_),
+          that.adaptor_.limit_,
+          that.adaptor_.ordered_),
         k_(std::move(that.k_)) {}
 
     ~Continuation() override = default;
@@ -727,10 +925,18 @@ struct _Concurrent final {
 
     template <typename Arg, typename K>
     auto k(K k) && {
-      return Continuation<K, F_, Arg>(std::move(k), std::move(f_));
+      return Continuation<K, F_, Arg>(
+          std::move(k),
+          std::move(f_),
+          limit_,
+          ordered_);
     }
 
     F_ f_;
+    size_t limit_;
+
+    // See 'TypeErasedAdaptor::ordered_'.
+    std::atomic<int>* ordered_ = nullptr;
   };
 };
 
@@ -742,7 +948,22 @@ auto Concurrent(F f) {
       std::is_invocable_v<F>,
       "Concurrent expects callable that takes no arguments");
 
-  return _Concurrent::Composable<F>{std::move(f)};
+  return _Concurrent::Composable<F>{
+      std::move(f),
+      std::numeric_limits<size_t>::max()};
+}
+
+////////////////////////////////////////////////////////////////////////
+
+template <typename F>
+auto Concurrent(size_t n, F f) {
+  static_assert(
+      std::is_invocable_v<F>,
+      "Concurrent expects callable that takes no arguments");
+
+  CHECK_GT(n, 0u) << "Concurrent expects at least 1 fiber";
+
+  return _Concurrent::Composable<F>{std::move(f), n};
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -2,6 +2,8 @@
 
 #include <sstream>
 
+#include "eventuals/os.h"
+
 ////////////////////////////////////////////////////////////////////////
 
 namespace eventuals {
@@ -260,7 +262,7 @@ EventLoop::~EventLoop() {
 ////////////////////////////////////////////////////////////////////////
 
 void EventLoop::RunForever() {
-  in_event_loop_ = true;
+  current_ = this;
   running_ = true;
 
   // NOTE: we'll truly run forever because handles like 'async_' will
@@ -268,7 +270,30 @@ void EventLoop::RunForever() {
   uv_run(&loop_, UV_RUN_DEFAULT);
 
   running_ = false;
-  in_event_loop_ = false;
+  current_ = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void EventLoop::RunUntilStopped() {
+  current_ = this;
+  running_ = true;
+
+  // NOTE: 'UV_RUN_ONCE' blocks for I/O but will return after
+  // 'Stop()' calls 'Interrupt()' so we can check 'stopped_'.
+  while (!stopped_.load()) {
+    uv_run(&loop_, UV_RUN_ONCE);
+  }
+
+  running_ = false;
+  current_ = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void EventLoop::Stop() {
+  stopped_.store(true);
+  Interrupt();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -286,7 +311,7 @@ void EventLoop::Interrupt() {
 ////////////////////////////////////////////////////////////////////////
 
 bool EventLoop::Continuable(Scheduler::Context* context) {
-  return InEventLoop();
+  return Current() == this;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -298,13 +323,9 @@ void EventLoop::Submit(Callback<void()> callback, Scheduler::Context* context) {
   context->block();
   context->callback = std::move(callback);
 
-  context->next = contexts_.load(std::memory_order_relaxed);
+  load_.fetch_add(1, std::memory_order_relaxed);
 
-  while (!contexts_.compare_exchange_weak(
-      context->next,
-      context,
-      std::memory_order_release,
-      std::memory_order_relaxed)) {}
+  contexts_.Push(context);
 
   Interrupt();
 }
@@ -312,37 +333,123 @@ void EventLoop::Submit(Callback<void()> callback, Scheduler::Context* context) {
 ////////////////////////////////////////////////////////////////////////
 
 void EventLoop::Check() {
-  Context* context = nullptr;
-  do {
-  load:
-    context = contexts_.load(std::memory_order_relaxed);
-
-    if (context != nullptr) {
-      if (context->next == nullptr) {
-        if (!contexts_.compare_exchange_weak(
-                context,
-                nullptr,
-                std::memory_order_release,
-                std::memory_order_relaxed)) {
-          goto load; // Try again.
-        }
-      } else {
-        while (context->next->next != nullptr) {
-          context = context->next;
-        }
+  // NOTE: we keep popping until the queue is empty, including any
+  // contexts that get submitted while we're running callbacks.
+  Context* context = contexts_.Pop();
+  while (context != nullptr) {
+    load_.fetch_sub(1, std::memory_order_relaxed);
+    // NOTE: we unblock the context and move out its callback _before_
+    // invoking it so that the callback can submit the same context
+    // again, e.g., a stream that gets asked for its next value.
+    context->unblock();
+    Callback<void()> callback = std::move(context->callback);
+    callback();
+    context = contexts_.Pop();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoop& EventLoop::ForCPU(unsigned int cpu) {
+  return EventLoopGroup::Default().ForCPU(cpu);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoop& EventLoop::LeastLoaded() {
+  return EventLoopGroup::Default().LeastLoaded();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+static EventLoopGroup* group = nullptr;
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoopGroup& EventLoopGroup::Default() {
+  CHECK(group)
+      << "default event loop group has not yet been constructed, "
+      << "did you forget to do 'EventLoopGroup::ConstructDefault()'?";
+  return *group;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void EventLoopGroup::ConstructDefault(size_t size) {
+  CHECK(!group) << "default already constructed";
+
+  group = new EventLoopGroup(size);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void EventLoopGroup::DestructDefault() {
+  CHECK(group) << "default not yet constructed";
+
+  delete group;
+  group = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoopGroup::EventLoopGroup(size_t size) {
+  CHECK_GT(size, 0u) << "event loop group must have at least one loop";
 
-        CHECK(context->next != nullptr);
+  loops_.reserve(size);
+  threads_.reserve(size);
 
-        auto* next = context->next;
-        context->next = nullptr;
-        context = next;
-      }
+  for (size_t i = 0; i < size; i++) {
+    loops_.emplace_back(new EventLoop());
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    threads_.emplace_back([this, i]() {
+      // NOTE: if there are more loops than CPUs then some CPUs will
+      // have more than one loop.
+      SetAffinity(threads_[i], i % std::thread::hardware_concurrency());
+
+      loops_[i]->RunUntilStopped();
+    });
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoopGroup::~EventLoopGroup() {
+  for (auto& loop : loops_) {
+    loop->Stop();
+  }
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+
+  // NOTE: destructing each loop will run it until it is no longer
+  // alive, i.e., until all of its handles have been closed.
+  loops_.clear();
+}
 
-      CHECK_NOTNULL(context);
+////////////////////////////////////////////////////////////////////////
 
-      context->callback();
+EventLoop& EventLoopGroup::LeastLoaded() {
+  // NOTE: we start looking at a different loop each time so that
+  // concurrent callers that see the same loads (e.g., when all of the
+  // loops are idle) don't all pick the same loop.
+  size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+
+  auto* loop = loops_[start % loops_.size()].get();
+  size_t load = loop->Load();
+
+  for (size_t i = 1; i < loops_.size() && load > 0; i++) {
+    auto* candidate = loops_[(start + i) % loops_.size()].get();
+    size_t candidate_load = candidate->Load();
+    if (candidate_load < load) {
+      loop = candidate;
+      load = candidate_load;
     }
-  } while (context != nullptr);
+  }
+
+  return *loop;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -9,7 +9,9 @@
 #include <mutex>
 #include <optional>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <vector>
 
 #include "eventuals/callback.h"
 #include "eventuals/closure.h"
@@ -285,23 +287,12 @@ class EventLoop final : public Scheduler {
 
         template <typename Error>
         void Fail(Error&& error) {
-          // TODO(benh): avoid allocating on heap by storing args in
-          // pre-allocated buffer based on composing with Errors.
-          using Tuple = std::tuple<decltype(this), Error>;
-          auto tuple = std::make_unique<Tuple>(
-              this,
-              std::forward<Error>(error));
-
           // Submitting to event loop to avoid race with interrupt.
           loop().Submit(
-              this->Borrow([tuple = std::move(tuple)]() mutable {
-                std::apply(
-                    [](auto* continuation, auto&&... args) {
-                      auto& k_ = continuation->k_;
-                      k_.Fail(std::forward<decltype(args)>(args)...);
-                    },
-                    std::move(*tuple));
-              }),
+              Pooled(this->Borrow(
+                  [this, error = std::forward<Error>(error)]() mutable {
+                    k_.Fail(std::move(error));
+                  })),
               &context_);
         }
 
@@ -441,6 +432,13 @@ class EventLoop final : public Scheduler {
 
   static void ConstructDefaultAndRunForeverDetached();
 
+  // Returns the loop of the default 'EventLoopGroup' for the
+  // specified CPU (modulo the number of loops in the group).
+  static EventLoop& ForCPU(unsigned int cpu);
+
+  // Returns the least loaded loop of the default 'EventLoopGroup'.
+  static EventLoop& LeastLoaded();
+
   EventLoop();
   EventLoop(const EventLoop&) = delete;
   ~EventLoop() override;
@@ -451,7 +449,8 @@ class EventLoop final : public Scheduler {
   void RunUntil(std::future<T>& future) {
     auto status = std::future_status::ready;
     do {
-      in_event_loop_ = true;
+      auto* previous = current_;
+      current_ = this;
       running_ = true;
 
       // NOTE: We use 'UV_RUN_NOWAIT' because we don't want to block on
@@ -459,12 +458,18 @@ class EventLoop final : public Scheduler {
       uv_run(&loop_, UV_RUN_NOWAIT);
 
       running_ = false;
-      in_event_loop_ = false;
+      current_ = previous;
 
       status = future.wait_for(std::chrono::nanoseconds::zero());
     } while (status != std::future_status::ready);
   }
 
+  // Runs the event loop until 'Stop()' gets called, possibly from
+  // another thread.
+  void RunUntilStopped();
+
+  void Stop();
+
   // Interrupts the event loop; necessary to have the loop redetermine
   // an I/O polling timeout in the event that a timer was removed
   // while it was executing.
@@ -492,7 +497,20 @@ class EventLoop final : public Scheduler {
   }
 
   static bool InEventLoop() {
-    return in_event_loop_;
+    return current_ != nullptr;
+  }
+
+  // Returns the event loop that the current thread is running, if
+  // any, which is necessary to distinguish between loops when there
+  // is more than one, e.g., when using an 'EventLoopGroup'.
+  static EventLoop* Current() {
+    return current_;
+  }
+
+  // Returns the number of callbacks that have been submitted but not
+  // yet invoked.
+  size_t Load() {
+    return load_.load(std::memory_order_relaxed);
   }
 
   operator uv_loop_t*() {
@@ -585,23 +603,12 @@ class EventLoop final : public Scheduler {
 
       template <typename Error>
       void Fail(Error&& error) {
-        // TODO(benh): avoid allocating on heap by storing args in
-        // pre-allocated buffer based on composing with Errors.
-        using Tuple = std::tuple<decltype(this), Error>;
-        auto tuple = std::make_unique<Tuple>(
-            this,
-            std::forward<Error>(error));
-
         // Submitting to event loop to avoid race with interrupt.
         loop_.Submit(
-            this->Borrow([tuple = std::move(tuple)]() {
-              std::apply(
-                  [](auto* continuation, auto&&... args) {
-                    auto& k_ = continuation->k_;
-                    k_.Fail(std::forward<decltype(args)>(args)...);
-                  },
-                  std::move(*tuple));
-            }),
+            Pooled(this->Borrow(
+                [this, error = std::forward<Error>(error)]() mutable {
+                  k_.Fail(std::move(error));
+                })),
             &context_);
       }
 
@@ -713,10 +720,13 @@ class EventLoop final : public Scheduler {
   uv_async_t async_;
 
   std::atomic<bool> running_ = false;
+  std::atomic<bool> stopped_ = false;
+
+  std::atomic<size_t> load_ = 0;
 
-  static inline thread_local bool in_event_loop_ = false;
+  static inline thread_local EventLoop* current_ = nullptr;
 
-  std::atomic<Scheduler::Context*> contexts_ = nullptr;
+  Scheduler::Queue contexts_;
 
   Clock clock_;
 };
@@ -746,7 +756,7 @@ struct _EventLoopSchedule final {
           !std::is_void_v<Arg_> || sizeof...(args) == 0,
           "'Schedule' only supports 0 or 1 argument");
 
-      if (loop()->InEventLoop()) {
+      if (EventLoop::Current() == loop()) {
         Adapt();
         auto* previous = Scheduler::Context::Switch(context_.get());
         adapted_->Start(std::forward<Args>(args)...);
@@ -776,30 +786,19 @@ struct _EventLoopSchedule final {
       // to support the use case where code wants to "catch" a failure
       // inside of a 'Schedule()' in order to either recover or
       // propagate a different failure.
-      if (loop()->InEventLoop()) {
+      if (EventLoop::Current() == loop()) {
         Adapt();
         auto* previous = Scheduler::Context::Switch(context_.get());
         adapted_->Fail(std::forward<Error>(error));
         previous = Scheduler::Context::Switch(previous);
         CHECK_EQ(previous, context_.get());
       } else {
-        // TODO(benh): avoid allocating on heap by storing args in
-        // pre-allocated buffer based on composing with Errors.
-        using Tuple = std::tuple<decltype(this), Error>;
-        auto tuple = std::make_unique<Tuple>(
-            this,
-            std::forward<Error>(error));
-
         loop()->Submit(
-            this->Borrow([tuple = std::move(tuple)]() mutable {
-              std::apply(
-                  [](auto* schedule, auto&&... args) {
-                    schedule->Adapt();
-                    schedule->adapted_->Fail(
-                        std::forward<decltype(args)>(args)...);
-                  },
-                  std::move(*tuple));
-            }),
+            Pooled(this->Borrow(
+                [this, error = std::forward<Error>(error)]() mutable {
+                  Adapt();
+                  adapted_->Fail(std::move(error));
+                })),
             context_.get());
       }
     }
@@ -810,7 +809,7 @@ struct _EventLoopSchedule final {
       // stop inside of a 'Schedule()' in order to do something
       // different.
 
-      if (loop()->InEventLoop()) {
+      if (EventLoop::Current() == loop()) {
         Adapt();
         auto* previous = Scheduler::Context::Switch(context_.get());
         adapted_->Stop();
@@ -927,6 +926,44 @@ auto EventLoop::Schedule(std::string&& name, E e) {
 
 ////////////////////////////////////////////////////////////////////////
 
+// A group of event loops, one per CPU by default, each run by its own
+// thread pinned to the CPU, so that I/O (timers, HTTP, filesystem,
+// etc) isn't limited to a single core. Use 'ForCPU()' or
+// 'LeastLoaded()' to pick a loop and then schedule on it like any
+// other loop, e.g., 'loop.Schedule(...)' or 'loop.clock().Timer(...)'.
+class EventLoopGroup final {
+ public:
+  // Getter/Resetter for default event loop group.
+  static EventLoopGroup& Default();
+  static void ConstructDefault(
+      size_t size = std::thread::hardware_concurrency());
+  static void DestructDefault();
+
+  explicit EventLoopGroup(size_t size = std::thread::hardware_concurrency());
+  EventLoopGroup(const EventLoopGroup&) = delete;
+  ~EventLoopGroup();
+
+  size_t size() {
+    return loops_.size();
+  }
+
+  // Returns the loop for the specified CPU modulo 'size()'.
+  EventLoop& ForCPU(unsigned int cpu) {
+    return *loops_[cpu % loops_.size()];
+  }
+
+  // Returns the loop with the fewest callbacks waiting to be invoked.
+  EventLoop& LeastLoaded();
+
+ private:
+  std::vector<std::unique_ptr<EventLoop>> loops_;
+  std::vector<std::thread> threads_;
+
+  std::atomic<unsigned int> next_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////
+
 // Returns the default event loop's clock.
 inline auto& Clock() {
   return EventLoop::Default().clock();
@@ -4,10 +4,15 @@
 #include "eventuals/eventual.h"
 #include "eventuals/grpc/completion-pool.h"
 #include "eventuals/grpc/logging.h"
+#include "eventuals/grpc/method.h"
 #include "eventuals/grpc/traits.h"
+#include "eventuals/grpc/write-buffering.h"
 #include "eventuals/lazy.h"
+#include "eventuals/loop.h"
+#include "eventuals/map.h"
 #include "eventuals/stream.h"
 #include "eventuals/then.h"
+#include "google/protobuf/arena.h"
 #include "grpcpp/client_context.h"
 #include "grpcpp/completion_queue.h"
 #include "grpcpp/create_channel.h"
@@ -41,18 +46,41 @@ class ClientReader {
       stream_(stream) {}
 
   auto Read() {
+    return Read<ResponseType_>(
+        [response = ResponseType_()]() mutable {
+          return &response;
+        });
+  }
+
+  // Like 'Read()' but each response gets allocated on 'arena' (e.g.,
+  // 'ClientCall::arena()') and is emitted as a reference that stays
+  // valid until 'arena' gets destructed (or reset) so reading deeply
+  // nested responses doesn't need lots of small heap allocations
+  // that get freed right away.
+  auto Read(google::protobuf::Arena* arena) {
+    return Read<ResponseType_&>([arena = CHECK_NOTNULL(arena)]() {
+      return google::protobuf::Arena::CreateMessage<ResponseType_>(arena);
+    });
+  }
+
+ private:
+  // Helper for the 'Read()' overloads that reads each response into
+  // the one returned from 'response()' and emits it as 'Value_',
+  // i.e., either moved out of (a value) or as a reference.
+  template <typename Value_, typename F_>
+  auto Read(F_ response) {
     struct Data {
       ClientReader* reader = nullptr;
-      ResponseType_ response;
+      F_ response;
+      ResponseType_* next = nullptr;
       void* k = nullptr;
     };
-    return eventuals::Stream<ResponseType_>()
+    return eventuals::Stream<Value_>()
         .next([this,
-               data = Data{},
+               data = Data{this, std::move(response)},
                callback = Callback<void(bool)>()](auto& k) mutable {
           using K = std::decay_t<decltype(k)>;
           if (!callback) {
-            data.reader = this;
             data.k = &k;
             callback = [&data](bool ok) mutable {
               auto& k = *reinterpret_cast<K*>(data.k);
@@ -63,9 +91,13 @@ class ClientReader {
                     << " with host = " << data.reader->host_.value_or("*")
                     << " with path = " << data.reader->path_
                     << " and response =\n"
-                    << data.response.DebugString();
+                    << DebugString(*data.next);
 
-                k.Emit(std::move(data.response));
+                if constexpr (std::is_reference_v<Value_>) {
+                  k.Emit(*data.next);
+                } else {
+                  k.Emit(std::move(*data.next));
+                }
               } else {
                 EVENTUALS_GRPC_LOG(1)
                     << "Received notice of last response (or error) for call ("
@@ -79,11 +111,12 @@ class ClientReader {
             };
           }
 
-          stream_->Read(&data.response, &callback);
+          data.next = data.response();
+
+          stream_->Read(data.next, &callback);
         });
   }
 
- private:
   // TODO(benh): explicitly borrow these for better safety (they come
   // from 'ClientCall' and outlive this 'ClientReader').
   const std::string& path_;
@@ -141,7 +174,7 @@ class ClientWriter {
                   << " with host = " << host_.value_or("*")
                   << " with path = " << path_
                   << " and request =\n"
-                  << request.DebugString();
+                  << DebugString(request);
 
               stream_->Write(request, options, &callback);
             });
@@ -153,6 +186,34 @@ class ClientWriter {
     return Write(request, options.set_last_message());
   }
 
+
+  // Returns a stream consumer that writes every request of the
+  // stream it gets composed with, letting gRPC buffer (coalesce)
+  // them rather than flushing each to the network as determined by
+  // 'buffering', e.g., 'Iterate(requests) | call.Writer().WriteMany()'.
+  //
+  // NOTE: the last request is held back until either another
+  // request follows it or the delay of 'buffering' expires, see
+  // 'CoalescedWrites()', so no request stays buffered for longer
+  // than that delay even if the stream of requests stalls.
+  auto WriteMany(WriteBuffering buffering = WriteBuffering()) {
+    return CoalescedWrites<RequestType_>(
+        buffering,
+        [this](
+            const RequestType_& request,
+            ::grpc::WriteOptions options,
+            Callback<void(bool)>* callback) {
+          EVENTUALS_GRPC_LOG(1)
+              << "Sending request for call (" << context_ << ")"
+              << " with host = " << host_.value_or("*")
+              << " with path = " << path_
+              << " and request =\n"
+              << DebugString(request);
+
+          stream_->Write(request, options, callback);
+        });
+  }
+
  private:
   // TODO(benh): explicitly borrow these for better safety (they come
   // from 'ClientCall' and outlive this 'ClientWriter').
@@ -204,6 +265,22 @@ class ClientCall {
     return context_;
   }
 
+  // Returns an arena, created on first use, for allocating messages
+  // (e.g., 'Reader().Read(call.arena())') that all get freed at once
+  // when this call gets destructed.
+  //
+  // NOTE: an arena never frees individual messages so it retains
+  // every message allocated on it until the call ends, i.e., memory
+  // grows with the number of responses read, hence for long lived
+  // streaming calls prefer 'Reader().Read()' or an arena of your
+  // own that you reset periodically.
+  google::protobuf::Arena* arena() {
+    if (!arena_) {
+      arena_ = std::make_unique<google::protobuf::Arena>();
+    }
+    return arena_.get();
+  }
+
   auto& Reader() {
     return reader_;
   }
@@ -270,6 +347,10 @@ class ClientCall {
   }
 
  private:
+  // NOTE: declared first so that it gets destructed last, i.e., after
+  // anything that might still refer to messages allocated on it.
+  std::unique_ptr<google::protobuf::Arena> arena_;
+
   // TODO(benh): explicitly borrow these for better safety (they come
   // from 'Client::Call()' and outlive this 'ClientCall').
   const std::string& path_;
@@ -333,6 +414,77 @@ class Client {
       std::string name,
       ::grpc::ClientContext* context,
       std::optional<std::string> host = std::nullopt) {
+    return Prepare<Request, Response>(
+        std::move(name),
+        nullptr,
+        context,
+        std::move(host));
+  }
+
+  // Like 'Call()' above but uses a method that has already been
+  // resolved and validated so that we can skip doing so for each
+  // call. 'handle' must outlive the call.
+  template <typename Service, typename Request, typename Response>
+  auto Call(
+      const MethodHandle<Service, Request, Response>& handle,
+      ::grpc::ClientContext* context,
+      std::optional<std::string> host = std::nullopt) {
+    return Prepare<Request, Response>(
+        std::string(),
+        &handle.method(),
+        context,
+        std::move(host));
+  }
+
+  template <typename Service, typename Request, typename Response>
+  auto Call(
+      const std::string& name,
+      std::optional<std::string> host = std::nullopt) {
+    static_assert(
+        IsService<Service>::value,
+        "expecting \"service\" type to be a protobuf 'Service'");
+
+    return Call<Request, Response>(
+        std::string(Service::service_full_name()) + "." + name,
+        std::move(host));
+  }
+
+  template <typename Request, typename Response>
+  auto Call(
+      std::string name,
+      std::optional<std::string> host = std::nullopt) {
+    return Context()
+        | Then([this,
+                name = std::move(name),
+                host = std::move(host)](
+                   ::grpc::ClientContext* context) mutable {
+             return Call<Request, Response>(
+                 std::move(name),
+                 context,
+                 std::move(host));
+           });
+  }
+
+  template <typename Service, typename Request, typename Response>
+  auto Call(
+      const MethodHandle<Service, Request, Response>& handle,
+      std::optional<std::string> host = std::nullopt) {
+    return Context()
+        | Then([this, &handle, host = std::move(host)](
+                   ::grpc::ClientContext* context) mutable {
+             return Call(handle, context, std::move(host));
+           });
+  }
+
+ private:
+  // Prepares and starts a call for 'method', or for 'name' if
+  // 'method' is null in which case the method gets resolved first.
+  template <typename Request, typename Response>
+  auto Prepare(
+      std::string name,
+      const Method* method,
+      ::grpc::ClientContext* context,
+      std::optional<std::string> host) {
     static_assert(
         IsMessage<Request>::value,
         "expecting \"request\" type to be a protobuf 'Message'");
@@ -348,7 +500,8 @@ class Client {
     struct Data {
       ::grpc::ClientContext* context;
       std::string name;
-      std::string path;
+      const Method* method;
+      std::optional<Method> resolved;
       std::optional<std::string> host;
       stout::borrowed_ptr<::grpc::CompletionQueue> cq;
       ::grpc::TemplatedGenericStub<RequestType, ResponseType> stub;
@@ -366,125 +519,88 @@ class Client {
             [data = Data{
                  context,
                  std::move(name),
-                 std::string(),
+                 method,
+                 std::nullopt,
                  std::move(host),
                  pool_->Schedule(),
                  ::grpc::TemplatedGenericStub<
                      RequestType,
                      ResponseType>(channel_)},
              callback = Callback<void(bool)>()](auto& k) mutable {
-              const auto* method =
-                  google::protobuf::DescriptorPool::generated_pool()
-                      ->FindMethodByName(data.name);
+              if (data.method == nullptr) {
+                data.resolved =
+                    Method::Resolve<Request, Response>(std::move(data.name));
+                data.method = &data.resolved.value();
+              }
 
-              if (method == nullptr) {
-                k.Fail(std::runtime_error(
-                    "Method " + data.name + " not found"));
+              if (data.method->error()) {
+                k.Fail(std::runtime_error(data.method->error().value()));
               } else {
-                auto error = Traits::Validate<Request, Response>(method);
-                if (error) {
-                  k.Fail(std::runtime_error(error->message));
-                } else {
-                  if (data.host) {
-                    data.context->set_authority(data.host.value());
-                  }
+                if (data.host) {
+                  data.context->set_authority(data.host.value());
+                }
 
-                  data.path = "/" + data.name;
-                  size_t index = data.path.find_last_of(".");
-                  data.path.replace(index, 1, "/");
+                EVENTUALS_GRPC_LOG(1)
+                    << "Preparing call (" << data.context << ")"
+                    << " with host = " << data.host.value_or("*")
+                    << " with path = " << data.method->path();
 
+                data.stream = data.stub.PrepareCall(
+                    data.context,
+                    data.method->path(),
+                    data.cq.get());
+
+                if (!data.stream) {
                   EVENTUALS_GRPC_LOG(1)
-                      << "Preparing call (" << data.context << ")"
+                      << "Failed to prepare call (" << data.context << ")"
                       << " with host = " << data.host.value_or("*")
-                      << " with path = " << data.path;
-
-                  data.stream = data.stub.PrepareCall(
-                      data.context,
-                      data.path,
-                      data.cq.get());
-
-                  if (!data.stream) {
-                    EVENTUALS_GRPC_LOG(1)
-                        << "Failed to prepare call (" << data.context << ")"
-                        << " with host = " << data.host.value_or("*")
-                        << " with path = " << data.path;
-
-                    // TODO(benh): Check status of channel, is this a
-                    // redundant check because 'PrepareCall' also does
-                    // this?  At the very least we'll probably give a
-                    // better error message by checking.
-                    k.Fail(std::runtime_error("Failed to prepare call"));
-                  } else {
-                    using K = std::decay_t<decltype(k)>;
-                    data.k = &k;
-                    callback = [&data](bool ok) {
-                      auto& k = *reinterpret_cast<K*>(data.k);
-                      if (ok) {
-                        EVENTUALS_GRPC_LOG(1)
-                            << "Started call (" << data.context << ")"
-                            << " with host = " << data.host.value_or("*")
-                            << " with path = " << data.path;
-
-                        k.Start(
-                            ClientCall<Request, Response>(
-                                data.path,
-                                data.host,
-                                data.context,
-                                std::move(data.cq),
-                                std::move(data.stub),
-                                std::move(data.stream)));
-                      } else {
-                        EVENTUALS_GRPC_LOG(1)
-                            << "Failed to start call (" << data.context << ")"
-                            << " with host = " << data.host.value_or("*")
-                            << " with path = " << data.path;
-
-                        k.Fail(std::runtime_error("Failed to start call"));
-                      }
-                    };
-
-                    EVENTUALS_GRPC_LOG(1)
-                        << "Starting call (" << data.context << ")"
-                        << " with host = " << data.host.value_or("*")
-                        << " with path = " << data.path;
-
-                    data.stream->StartCall(&callback);
-                  }
-                }
-              }
-            });
-  }
+                      << " with path = " << data.method->path();
 
-  template <typename Service, typename Request, typename Response>
-  auto Call(
-      const std::string& name,
-      std::optional<std::string> host = std::nullopt) {
-    static_assert(
-        IsService<Service>::value,
-        "expecting \"service\" type to be a protobuf 'Service'");
+                  // TODO(benh): Check status of channel, is this a
+                  // redundant check because 'PrepareCall' also does
+                  // this?  At the very least we'll probably give a
+                  // better error message by checking.
+                  k.Fail(std::runtime_error("Failed to prepare call"));
+                } else {
+                  using K = std::decay_t<decltype(k)>;
+                  data.k = &k;
+                  callback = [&data](bool ok) {
+                    auto& k = *reinterpret_cast<K*>(data.k);
+                    if (ok) {
+                      EVENTUALS_GRPC_LOG(1)
+                          << "Started call (" << data.context << ")"
+                          << " with host = " << data.host.value_or("*")
+                          << " with path = " << data.method->path();
+
+                      k.Start(
+                          ClientCall<Request, Response>(
+                              data.method->path(),
+                              data.host,
+                              data.context,
+                              std::move(data.cq),
+                              std::move(data.stub),
+                              std::move(data.stream)));
+                    } else {
+                      EVENTUALS_GRPC_LOG(1)
+                          << "Failed to start call (" << data.context << ")"
+                          << " with host = " << data.host.value_or("*")
+                          << " with path = " << data.method->path();
+
+                      k.Fail(std::runtime_error("Failed to start call"));
+                    }
+                  };
 
-    return Call<Request, Response>(
-        std::string(Service::service_full_name()) + "." + name,
-        std::move(host));
-  }
+                  EVENTUALS_GRPC_LOG(1)
+                      << "Starting call (" << data.context << ")"
+                      << " with host = " << data.host.value_or("*")
+                      << " with path = " << data.method->path();
 
-  template <typename Request, typename Response>
-  auto Call(
-      std::string name,
-      std::optional<std::string> host = std::nullopt) {
-    return Context()
-        | Then([this,
-                name = std::move(name),
-                host = std::move(host)](
-                   ::grpc::ClientContext* context) mutable {
-             return Call<Request, Response>(
-                 std::move(name),
-                 context,
-                 std::move(host));
-           });
+                  data.stream->StartCall(&callback);
+                }
+              }
+            });
   }
 
- private:
   std::shared_ptr<::grpc::Channel> channel_;
   stout::borrowed_ptr<CompletionPool> pool_;
 };
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <random>
 #include <thread>
 
 #include "eventuals/callback.h"
+#include "eventuals/os.h"
+#include "eventuals/static-thread-pool.h"
+#include "grpc/support/time.h"
+#include "grpcpp/alarm.h"
 #include "grpcpp/completion_queue.h"
 #include "stout/borrowable.h"
 
@@ -16,7 +22,31 @@ namespace grpc {
 
 class CompletionPool {
  public:
-  CompletionPool() {
+  // Policies for picking a completion queue in 'Schedule()'.
+  enum class Placement {
+    // Pick the completion queue with the fewest outstanding calls.
+    LeastLoaded,
+
+    // Cycle through all of the completion queues.
+    RoundRobin,
+
+    // Pick a completion queue at random.
+    Random,
+
+    // Pick the completion queue for the CPU of the current thread if
+    // it is a member of the static thread pool, otherwise fall back
+    // to 'LeastLoaded'. Combined with 'pin' this means completions
+    // get handled on the same CPU that started the call.
+    Current,
+  };
+
+  // Creates a completion queue (and a thread to handle its
+  // completions) for each CPU. If 'pin' is true each thread gets
+  // pinned to its CPU.
+  CompletionPool(
+      Placement placement = Placement::LeastLoaded,
+      bool pin = false)
+    : placement_(placement) {
     unsigned int threads = std::thread::hardware_concurrency();
     threads_.reserve(threads);
     cqs_.reserve(threads);
@@ -30,6 +60,39 @@ class CompletionPool {
               (*static_cast<Callback<void(bool)>*>(tag))(ok);
             }
           });
+      if (pin) {
+        SetAffinity(threads_.back(), i);
+      }
+    }
+  }
+
+  // Creates a completion queue for each CPU of 'pool' whose
+  // completions get handled by the thread for that CPU in between
+  // resuming contexts, rather than by a separate thread, see
+  // 'StaticThreadPool::Poller'. Combined with 'Placement::Current'
+  // this means the completions of a call started from a CPU of 'pool'
+  // get handled, and resume their continuations, on that CPU without
+  // any hop through another thread.
+  //
+  // NOTE: there can be at most one such completion pool per
+  // 'StaticThreadPool' at a time since a CPU has at most one poller,
+  // see 'StaticThreadPool::SetPoller()'. Also, must not be shutdown
+  // (or destructed) from a thread of 'pool', see
+  // 'StaticThreadPool::RemovePoller()'.
+  CompletionPool(
+      StaticThreadPool& pool,
+      Placement placement = Placement::Current)
+    : placement_(placement),
+      pool_(&pool) {
+    cqs_.reserve(pool.concurrency);
+    pollers_.reserve(pool.concurrency);
+    for (unsigned int cpu = 0; cpu < pool.concurrency; cpu++) {
+      cqs_.emplace_back(new stout::Borrowable<::grpc::CompletionQueue>());
+      pollers_.emplace_back(new Poller(cqs_.back()->get()));
+      bool set = pool.SetPoller(cpu, pollers_.back().get());
+      CHECK(set)
+          << "CPU " << cpu << " already has a poller, only one polled"
+          << " 'CompletionPool' per 'StaticThreadPool' is supported";
     }
   }
 
@@ -40,6 +103,15 @@ class CompletionPool {
 
   void Shutdown() {
     if (!shutdown_) {
+      // NOTE: we stop polling before shutting down the completion
+      // queues because a poller can't be woken up (which requires
+      // setting an alarm) after its completion queue has been shut
+      // down. Any outstanding completions get handled in 'Wait()'.
+      if (pool_ != nullptr) {
+        for (unsigned int cpu = 0; cpu < pollers_.size(); cpu++) {
+          pool_->RemovePoller(cpu, pollers_[cpu].get());
+        }
+      }
       for (auto& cq : cqs_) {
         cq->get()->Shutdown();
       }
@@ -63,29 +135,162 @@ class CompletionPool {
 
       cqs_.pop_back();
     }
+
+    // Handle any outstanding completions if we were polling, see
+    // 'Shutdown()'.
+    while (!pollers_.empty()) {
+      auto& cq = cqs_.back();
+
+      void* tag = nullptr;
+      bool ok = false;
+      while (cq->get()->Next(&tag, &ok)) {
+        (*static_cast<Callback<void(bool)>*>(tag))(ok);
+      }
+
+      pollers_.pop_back();
+      cqs_.pop_back();
+    }
   }
 
   stout::borrowed_ptr<::grpc::CompletionQueue> Schedule() {
-    // TODO(benh): provide alternative "scheduling" algorithms in
-    // addition to "least loaded", e.g., round-robin, random.
-    stout::Borrowable<::grpc::CompletionQueue>* selected = nullptr;
-    size_t load = SIZE_MAX;
-    for (auto& cq : cqs_) {
-      auto borrows = cq->borrows();
-      if (borrows < load) {
-        selected = cq.get();
-        load = borrows;
-      }
+    return cqs_[Place()]->Borrow();
+  }
+
+  // Returns the number of completions that have been handled by the
+  // threads of the static thread pool, i.e., always 0 unless this
+  // completion pool was constructed with a 'StaticThreadPool'.
+  size_t polled() const {
+    size_t polled = 0;
+    for (auto& poller : pollers_) {
+      polled += poller->polled();
     }
-    CHECK(selected != nullptr);
-    return selected->Borrow();
+    return polled;
   }
 
  private:
+  // Handles completions from a completion queue on a thread of the
+  // static thread pool, see 'StaticThreadPool::Poller'.
+  class Poller final : public StaticThreadPool::Poller {
+   public:
+    Poller(::grpc::CompletionQueue* cq)
+      : cq_(cq) {
+      wake_ = [this](bool) {
+        waking_.store(false);
+      };
+    }
+
+    bool Poll() override {
+      // NOTE: we only handle a bounded number of completions at a
+      // time so that we don't starve any contexts waiting to resume.
+      for (size_t i = 0; i < MAX_COMPLETIONS; i++) {
+        if (!Next(gpr_time_0(GPR_CLOCK_MONOTONIC))) {
+          return i > 0;
+        }
+      }
+      return true;
+    }
+
+    void Wait() override {
+      Next(gpr_inf_future(GPR_CLOCK_MONOTONIC));
+    }
+
+    // Returns the number of completions this poller has handled
+    // (not including being woken up).
+    size_t polled() const {
+      return polled_.load(std::memory_order_relaxed);
+    }
+
+    void Wake() override {
+      // An alarm that has already expired is the only way to make a
+      // completion queue return from waiting without a completion.
+      if (!waking_.exchange(true)) {
+        alarm_.Set(cq_, gpr_time_0(GPR_CLOCK_MONOTONIC), &wake_);
+      }
+    }
+
+   private:
+    static constexpr size_t MAX_COMPLETIONS = 16;
+
+    // Handles the next completion if there is one before 'deadline'
+    // and returns whether or not there was one.
+    bool Next(gpr_timespec deadline) {
+      void* tag = nullptr;
+      bool ok = false;
+      if (cq_->AsyncNext(&tag, &ok, deadline)
+          == ::grpc::CompletionQueue::GOT_EVENT) {
+        if (tag != &wake_) {
+          polled_.fetch_add(1, std::memory_order_relaxed);
+        }
+        (*static_cast<Callback<void(bool)>*>(tag))(ok);
+        return true;
+      } else {
+        return false;
+      }
+    }
+
+    ::grpc::CompletionQueue* cq_;
+
+    ::grpc::Alarm alarm_;
+    Callback<void(bool)> wake_;
+    std::atomic<bool> waking_ = false;
+
+    std::atomic<size_t> polled_ = 0;
+  };
+
+  // Returns the index of the completion queue to use as determined
+  // by 'placement_'.
+  size_t Place() {
+    CHECK(!cqs_.empty());
+
+    switch (placement_) {
+      case Placement::Current:
+        if (StaticThreadPool::member && StaticThreadPool::cpu < cqs_.size()) {
+          return StaticThreadPool::cpu;
+        }
+        break;
+      case Placement::RoundRobin:
+        return next_.fetch_add(1, std::memory_order_relaxed) % cqs_.size();
+      case Placement::Random: {
+        static thread_local std::minstd_rand random(std::random_device{}());
+        return random() % cqs_.size();
+      }
+      case Placement::LeastLoaded:
+        break;
+    }
+
+    // NOTE: like 'StaticThreadPool::Place()' we start looking at a
+    // different completion queue each time so that concurrent calls
+    // that see the same loads don't all pick the same queue, and we
+    // stop looking as soon as we find a queue without any load.
+    size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+
+    size_t index = start % cqs_.size();
+    size_t load = cqs_[index]->borrows();
+
+    for (size_t i = 1; i < cqs_.size() && load > 0; i++) {
+      size_t candidate = (start + i) % cqs_.size();
+      size_t candidate_load = cqs_[candidate]->borrows();
+      if (candidate_load < load) {
+        index = candidate;
+        load = candidate_load;
+      }
+    }
+
+    return index;
+  }
+
+  const Placement placement_;
+
+  std::atomic<size_t> next_ = 0;
+
   std::vector<std::unique_ptr<stout::Borrowable<::grpc::CompletionQueue>>> cqs_;
 
   std::vector<std::thread> threads_;
 
+  // Only used when polling from a static thread pool.
+  StaticThreadPool* pool_ = nullptr;
+  std::vector<std::unique_ptr<Poller>> pollers_;
+
   bool shutdown_ = false;
 };
 
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "eventuals/grpc/traits.h"
+#include "google/protobuf/descriptor.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+namespace grpc {
+
+////////////////////////////////////////////////////////////////////////
+
+// Untyped result of resolving a method by its fully qualified name,
+// i.e., looking up its descriptor, validating it against the expected
+// request/response types, and computing the path used for calls.
+class Method {
+ public:
+  template <typename Request, typename Response>
+  static Method Resolve(std::string name) {
+    using Traits = RequestResponseTraits;
+
+    Method method;
+
+    // See comment on 'RawBytes' for why we don't validate.
+    if constexpr (!IsRawBytes<Request>::value
+                  && !IsRawBytes<Response>::value) {
+      const auto* descriptor =
+          google::protobuf::DescriptorPool::generated_pool()
+              ->FindMethodByName(name);
+
+      if (descriptor == nullptr) {
+        method.error_ = "Method " + name + " not found";
+      } else {
+        auto error = Traits::Validate<Request, Response>(descriptor);
+        if (error) {
+          method.error_ = std::move(error->message);
+        }
+      }
+    }
+
+    if (!method.error_) {
+      method.path_ = "/" + name;
+      size_t index = method.path_.find_last_of(".");
+      method.path_.replace(index, 1, "/");
+    }
+
+    method.name_ = std::move(name);
+
+    return method;
+  }
+
+  const std::string& name() const {
+    return name_;
+  }
+
+  // NOTE: only valid if there isn't an error.
+  const std::string& path() const {
+    return path_;
+  }
+
+  const std::optional<std::string>& error() const {
+    return error_;
+  }
+
+ private:
+  Method() = default;
+
+  std::string name_;
+  std::string path_;
+  std::optional<std::string> error_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Typed handle for a method of 'Service_' which resolves and validates
+// the method once (at construction) so that it can be reused for any
+// number of calls, e.g., 'Client::Call(handle, ...)' doesn't need to
+// do any descriptor lookups or string building.
+//
+// NOTE: a handle must outlive any calls that use it, which is why
+// generated code provides handles as function local statics.
+template <typename Service_, typename Request_, typename Response_>
+class MethodHandle final {
+ public:
+  static_assert(
+      IsService<Service_>::value,
+      "expecting \"service\" type to be a protobuf 'Service'");
+
+  static_assert(
+      IsMessage<Request_>::value,
+      "expecting \"request\" type to be a protobuf 'Message'");
+
+  static_assert(
+      IsMessage<Response_>::value,
+      "expecting \"response\" type to be a protobuf 'Message'");
+
+  explicit MethodHandle(std::string_view name)
+    : method_(Method::Resolve<Request_, Response_>(
+        std::string(Service_::service_full_name())
+        + "."
+        + std::string(name))) {}
+
+  MethodHandle(const MethodHandle&) = delete;
+  MethodHandle(MethodHandle&&) = delete;
+
+  const Method& method() const {
+    return method_;
+  }
+
+ private:
+  const Method method_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace grpc
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
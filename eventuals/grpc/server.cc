@@ -56,25 +56,34 @@ auto Server::RequestCall(
 auto Server::Lookup(ServerContext* context) {
   // NOTE: 'context' is stored in a 'Closure()' so safe to capture as
   // a reference here.
-  return Synchronized(Then([this, context]() {
+  //
+  // NOTE: we don't need to be 'Synchronized()' here because we only
+  // read from an immutable snapshot of the routes, see 'routes_'.
+  return Then([this, context]() {
     Endpoint* endpoint = nullptr;
 
-    auto iterator = endpoints_.find(
-        std::make_pair(context->method(), context->host()));
+    const Routes* routes = routes_.load(std::memory_order_acquire);
 
-    if (iterator != endpoints_.end()) {
-      endpoint = iterator->second.get();
-    } else {
-      iterator = endpoints_.find(
-          std::make_pair(context->method(), "*"));
+    if (routes != nullptr) {
+      std::string_view method = context->method();
+
+      auto iterator = routes->find(
+          std::make_pair(method, std::string_view(context->host())));
+
+      if (iterator != routes->end()) {
+        endpoint = iterator->second;
+      } else {
+        iterator = routes->find(
+            std::make_pair(method, std::string_view("*")));
 
-      if (iterator != endpoints_.end()) {
-        endpoint = iterator->second.get();
+        if (iterator != routes->end()) {
+          endpoint = iterator->second;
+        }
       }
     }
 
     return endpoint;
-  }));
+  });
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -102,11 +111,16 @@ Server::Server(
     std::unique_ptr<::grpc::AsyncGenericService>&& service,
     std::unique_ptr<::grpc::Server>&& server,
     std::vector<std::unique_ptr<::grpc::ServerCompletionQueue>>&& cqs,
-    std::vector<std::thread>&& threads)
+    std::vector<std::thread>&& threads,
+    size_t outstandingRequestsPerCompletionQueue,
+    size_t maximumQueuedCallsPerEndpoint,
+    ChannelOverflow queuedCallsOverflow)
   : service_(std::move(service)),
     server_(std::move(server)),
     cqs_(std::move(cqs)),
-    threads_(std::move(threads)) {
+    threads_(std::move(threads)),
+    maximumQueuedCallsPerEndpoint_(maximumQueuedCallsPerEndpoint),
+    queuedCallsOverflow_(queuedCallsOverflow) {
   for (auto* service : services) {
     auto& serve = serves_.emplace_back(std::make_unique<Serve>());
 
@@ -150,65 +164,69 @@ Server::Server(
         });
   }
 
-  workers_.reserve(cqs_.size());
+  workers_.reserve(cqs_.size() * outstandingRequestsPerCompletionQueue);
 
   for (auto&& cq : cqs_) {
-    auto& worker = workers_.emplace_back(std::make_unique<Worker>());
-
-    worker->task.emplace(
-        cq.get(),
-        [this](auto* cq) {
-          return Closure(
-              [this, cq, context = std::unique_ptr<ServerContext>()]() mutable {
-                // Use a separate preemptible scheduler context for
-                // each worker so that we correctly handle any waiting
-                // (e.g., on 'Lock' or 'Wait').
-                return Preempt(
-                    "[" + std::to_string((size_t) cq) + "]",
-                    Repeat([&]() mutable {
-                      context = std::make_unique<ServerContext>();
-                      return RequestCall(context.get(), cq)
-                          | Lookup(context.get())
-                          | Conditional(
-                                 [](auto* endpoint) {
-                                   return endpoint != nullptr;
-                                 },
-                                 [&](auto* endpoint) {
-                                   return endpoint->Enqueue(
-                                       std::move(context));
-                                 },
-                                 [&](auto*) {
-                                   return Unimplemented(context.release());
-                                 });
-                    })
-                        | Loop()
-                        | Catch()
-                              .raised<std::exception>(
-                                  [this](std::exception&& e) {
-                                    EVENTUALS_GRPC_LOG(1)
-                                        << "Failed to accept a call: "
-                                        << e.what() << "; shutting down";
-
-                                    // TODO(benh): refactor so we only call
-                                    // 'ShutdownEndpoints()' once on server
-                                    // shutdown, not for each worker (which
-                                    // should be harmless but unnecessary).
-                                    return ShutdownEndpoints();
-                                  }));
-              });
-        });
-
-    worker->task->Start(
-        worker->interrupt,
-        [&worker]() {
-          worker->done.store(true);
-        },
-        [](std::exception_ptr) {
-          LOG(FATAL) << "Unreachable";
-        },
-        []() {
-          LOG(FATAL) << "Unreachable";
-        });
+    for (size_t i = 0; i < outstandingRequestsPerCompletionQueue; ++i) {
+      auto& worker = workers_.emplace_back(std::make_unique<Worker>());
+
+      worker->task.emplace(
+          cq.get(),
+          [this](auto* cq) {
+            return Closure(
+                [this,
+                 cq,
+                 context = std::unique_ptr<ServerContext>()]() mutable {
+                  // Use a separate preemptible scheduler context for
+                  // each worker so that we correctly handle any waiting
+                  // (e.g., on 'Lock' or 'Wait').
+                  return Preempt(
+                      "[" + std::to_string((size_t) cq) + "]",
+                      Repeat([&]() mutable {
+                        context = std::make_unique<ServerContext>();
+                        return RequestCall(context.get(), cq)
+                            | Lookup(context.get())
+                            | Conditional(
+                                   [](auto* endpoint) {
+                                     return endpoint != nullptr;
+                                   },
+                                   [&](auto* endpoint) {
+                                     return endpoint->Enqueue(
+                                         std::move(context));
+                                   },
+                                   [&](auto*) {
+                                     return Unimplemented(context.release());
+                                   });
+                      })
+                          | Loop()
+                          | Catch()
+                                .raised<std::exception>(
+                                    [this](std::exception&& e) {
+                                      EVENTUALS_GRPC_LOG(1)
+                                          << "Failed to accept a call: "
+                                          << e.what() << "; shutting down";
+
+                                      // TODO(benh): refactor so we only call
+                                      // 'ShutdownEndpoints()' once on server
+                                      // shutdown, not for each worker (which
+                                      // should be harmless but unnecessary).
+                                      return ShutdownEndpoints();
+                                    }));
+                });
+          });
+
+      worker->task->Start(
+          worker->interrupt,
+          [&worker]() {
+            worker->done.store(true);
+          },
+          [](std::exception_ptr) {
+            LOG(FATAL) << "Unreachable";
+          },
+          []() {
+            LOG(FATAL) << "Unreachable";
+          });
+    }
   }
 }
 
@@ -333,6 +351,54 @@ ServerBuilder& ServerBuilder::SetMinimumThreadsPerCompletionQueue(size_t n) {
 
 ////////////////////////////////////////////////////////////////////////
 
+ServerBuilder& ServerBuilder::SetOutstandingRequestsPerCompletionQueue(
+    size_t n) {
+  std::optional<std::string> error;
+  if (outstandingRequestsPerCompletionQueue_) {
+    error = "already set outstanding requests per completion queue";
+  } else if (n == 0) {
+    error = "outstanding requests per completion queue must be positive";
+  }
+
+  if (error) {
+    if (!status_.ok()) {
+      status_ = ServerStatus::Error(status_.error() + "; " + *error);
+    } else {
+      status_ = ServerStatus::Error(*error);
+    }
+  } else {
+    outstandingRequestsPerCompletionQueue_ = n;
+  }
+  return *this;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+ServerBuilder& ServerBuilder::SetMaximumQueuedCallsPerEndpoint(
+    size_t n,
+    ChannelOverflow overflow) {
+  std::optional<std::string> error;
+  if (maximumQueuedCallsPerEndpoint_) {
+    error = "already set maximum queued calls per endpoint";
+  } else if (n == 0) {
+    error = "maximum queued calls per endpoint must be positive";
+  }
+
+  if (error) {
+    if (!status_.ok()) {
+      status_ = ServerStatus::Error(status_.error() + "; " + *error);
+    } else {
+      status_ = ServerStatus::Error(*error);
+    }
+  } else {
+    maximumQueuedCallsPerEndpoint_ = n;
+    queuedCallsOverflow_ = overflow;
+  }
+  return *this;
+}
+
+////////////////////////////////////////////////////////////////////////
+
 ServerBuilder& ServerBuilder::AddListeningPort(
     const std::string& address,
     std::shared_ptr<::grpc::ServerCredentials> credentials,
@@ -379,6 +445,19 @@ ServerStatusOrServer ServerBuilder::BuildAndStart() {
     minimumThreadsPerCompletionQueue_ = 1;
   }
 
+  if (!outstandingRequestsPerCompletionQueue_) {
+    outstandingRequestsPerCompletionQueue_ = 1;
+  }
+
+  // NOTE: unless a maximum has been set we don't limit the number of
+  // queued calls, instead spilling any calls that don't fit in each
+  // endpoint's channel, since waiting for space in one endpoint's
+  // channel would stop us from accepting calls for every endpoint.
+  if (!maximumQueuedCallsPerEndpoint_) {
+    maximumQueuedCallsPerEndpoint_ = 1024;
+    queuedCallsOverflow_ = ChannelOverflow::Spill;
+  }
+
   std::vector<std::unique_ptr<::grpc::ServerCompletionQueue>> cqs;
 
   for (size_t i = 0; i < numberOfCompletionQueues_.value(); ++i) {
@@ -421,7 +500,10 @@ ServerStatusOrServer ServerBuilder::BuildAndStart() {
             std::move(service),
             std::move(server),
             std::move(cqs),
-            std::move(threads)))};
+            std::move(threads),
+            outstandingRequestsPerCompletionQueue_.value(),
+            maximumQueuedCallsPerEndpoint_.value(),
+            queuedCallsOverflow_))};
   }
 }
 
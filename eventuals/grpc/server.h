@@ -1,26 +1,30 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <deque>
+#include <string_view>
 #include <thread>
 
 #include "absl/container/flat_hash_map.h"
 #include "eventuals/catch.h"
+#include "eventuals/channel.h"
 #include "eventuals/eventual.h"
 #include "eventuals/grpc/logging.h"
 #include "eventuals/grpc/server.h"
 #include "eventuals/grpc/traits.h"
+#include "eventuals/grpc/write-buffering.h"
 #include "eventuals/head.h"
 #include "eventuals/iterate.h"
 #include "eventuals/just.h"
 #include "eventuals/lock.h"
 #include "eventuals/loop.h"
 #include "eventuals/map.h"
-#include "eventuals/pipe.h"
 #include "eventuals/repeat.h"
 #include "eventuals/task.h"
 #include "eventuals/then.h"
 #include "eventuals/until.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/descriptor.h"
 #include "grpcpp/completion_queue.h"
 #include "grpcpp/generic/async_generic_service.h"
@@ -129,11 +133,11 @@ struct ServerContext {
     return &stream_;
   }
 
-  std::string method() const {
+  const std::string& method() const {
     return context_.method();
   }
 
-  std::string host() const {
+  const std::string& host() const {
     return context_.host();
   }
 
@@ -164,35 +168,62 @@ class ServerReader {
     : context_(context) {}
 
   auto Read() {
+    return Read<RequestType_>(
+        [request = RequestType_()]() mutable {
+          return &request;
+        });
+  }
+
+  // Like 'Read()' but each request gets allocated on 'arena' (e.g.,
+  // 'ServerCall::arena()') and is emitted as a reference that stays
+  // valid until 'arena' gets destructed (or reset) so deserializing
+  // deeply nested requests doesn't need lots of small heap
+  // allocations that get freed right away.
+  auto Read(google::protobuf::Arena* arena) {
+    return Read<RequestType_&>([arena = CHECK_NOTNULL(arena)]() {
+      return google::protobuf::Arena::CreateMessage<RequestType_>(arena);
+    });
+  }
+
+ private:
+  // Helper for the 'Read()' overloads that deserializes each request
+  // into the one returned from 'request()' and emits it as 'Value_',
+  // i.e., either moved out of (a value) or as a reference.
+  template <typename Value_, typename F_>
+  auto Read(F_ request) {
     struct Data {
       ServerReader* reader = nullptr;
+      F_ request;
       ::grpc::ByteBuffer buffer;
       void* k = nullptr;
     };
-    return eventuals::Stream<RequestType_>()
+    return eventuals::Stream<Value_>()
         .template raises<std::runtime_error>()
         .next([this,
-               data = Data{},
+               data = Data{this, std::move(request)},
                callback = Callback<void(bool)>()](auto& k) mutable {
           using K = std::decay_t<decltype(k)>;
 
           if (!callback) {
-            data.reader = this;
             data.k = &k;
             callback = [&data](bool ok) mutable {
               auto& k = *reinterpret_cast<K*>(data.k);
               if (ok) {
-                RequestType_ request;
-                if (deserialize(&data.buffer, &request)) {
+                RequestType_* request = data.request();
+                if (deserialize(&data.buffer, request)) {
                   EVENTUALS_GRPC_LOG(1)
                       << "Received request for call ("
                       << data.reader->context_ << ")"
                       << " for host = " << data.reader->context_->host()
                       << " and path = " << data.reader->context_->method()
                       << " and request =\n"
-                      << request.DebugString();
+                      << DebugString(*request);
 
-                  k.Emit(std::move(request));
+                  if constexpr (std::is_reference_v<Value_>) {
+                    k.Emit(*request);
+                  } else {
+                    k.Emit(std::move(*request));
+                  }
                 } else {
                   k.Fail(std::runtime_error("Failed to deserialize request"));
                 }
@@ -213,20 +244,25 @@ class ServerReader {
         });
   }
 
- private:
   template <typename T>
   static bool deserialize(::grpc::ByteBuffer* buffer, T* t) {
-    auto status = ::grpc::SerializationTraits<T>::Deserialize(
-        buffer,
-        t);
-
-    if (status.ok()) {
+    if constexpr (IsRawBytes<T>::value) {
+      // Just take the slices, no need to parse anything.
+      t->Swap(buffer);
       return true;
     } else {
-      EVENTUALS_GRPC_LOG(1)
-          << "Failed to deserialize " << t->GetTypeName()
-          << ": " << status.error_message();
-      return false;
+      auto status = ::grpc::SerializationTraits<T>::Deserialize(
+          buffer,
+          t);
+
+      if (status.ok()) {
+        return true;
+      } else {
+        EVENTUALS_GRPC_LOG(1)
+            << "Failed to deserialize " << t->GetTypeName()
+            << ": " << status.error_message();
+        return false;
+      }
     }
   }
 
@@ -274,7 +310,7 @@ class ServerWriter {
                     << " for host = " << context_->host()
                     << " and path = " << context_->method()
                     << " and response =\n"
-                    << response.DebugString();
+                    << DebugString(response);
 
                 context_->stream()->Write(buffer, options, &callback);
               } else {
@@ -300,7 +336,7 @@ class ServerWriter {
                     << " for host = " << context_->host()
                     << " and path = " << context_->method()
                     << " and response =\n"
-                    << response.DebugString();
+                    << DebugString(response);
 
                 // NOTE: 'WriteLast()' will block until calling
                 // 'Finish()' so we start the next continuation and
@@ -314,23 +350,63 @@ class ServerWriter {
             });
   }
 
+
+  // Returns a stream consumer that writes every response of the
+  // stream it gets composed with, letting gRPC buffer (coalesce)
+  // them rather than flushing each to the network as determined by
+  // 'buffering', e.g., 'Iterate(responses) | call.Writer().WriteMany()'.
+  //
+  // NOTE: the last response is held back until either another
+  // response follows it or the delay of 'buffering' expires, see
+  // 'CoalescedWrites()', so no response stays buffered for longer
+  // than that delay even if the stream of responses stalls.
+  auto WriteMany(WriteBuffering buffering = WriteBuffering()) {
+    return CoalescedWrites<ResponseType_>(
+        buffering,
+        [this](
+            const ResponseType_& response,
+            ::grpc::WriteOptions options,
+            Callback<void(bool)>* callback) {
+          ::grpc::ByteBuffer buffer;
+          if (serialize(response, &buffer)) {
+            EVENTUALS_GRPC_LOG(1)
+                << "Sending response for call (" << context_ << ")"
+                << " for host = " << context_->host()
+                << " and path = " << context_->method()
+                << " and response =\n"
+                << DebugString(response);
+
+            context_->stream()->Write(buffer, options, callback);
+          } else {
+            (*callback)(false);
+          }
+        });
+  }
+
  private:
   template <typename T>
   static bool serialize(const T& t, ::grpc::ByteBuffer* buffer) {
-    bool own = true;
-
-    auto status = ::grpc::SerializationTraits<T>::Serialize(
-        t,
-        buffer,
-        &own);
-
-    if (status.ok()) {
+    if constexpr (IsRawBytes<T>::value) {
+      // NOTE: copying a '::grpc::ByteBuffer' only references the
+      // slices it holds, it doesn't copy any bytes.
+      *buffer = t;
       return true;
     } else {
-      EVENTUALS_GRPC_LOG(1)
-          << "Failed to serialize " << t.GetTypeName()
-          << ": " << status.error_message();
-      return false;
+      bool own = true;
+
+      auto status = ::grpc::SerializationTraits<T>::Serialize(
+          t,
+          buffer,
+          &own);
+
+      if (status.ok()) {
+        return true;
+      } else {
+        EVENTUALS_GRPC_LOG(1)
+            << "Failed to serialize " << t.GetTypeName()
+            << ": " << status.error_message();
+        return false;
+      }
     }
   }
 
@@ -371,7 +447,8 @@ class ServerCall {
       writer_(context_.get()) {}
 
   ServerCall(ServerCall&& that)
-    : context_(std::move(that.context_)),
+    : arena_(std::move(that.arena_)),
+      context_(std::move(that.context_)),
       reader_(context_.get()),
       writer_(context_.get()) {}
 
@@ -379,6 +456,22 @@ class ServerCall {
     return context_->context();
   }
 
+  // Returns an arena, created on first use, for allocating messages
+  // (e.g., 'Reader().Read(call.arena())') that all get freed at once
+  // when this call gets destructed.
+  //
+  // NOTE: an arena never frees individual messages so it retains
+  // every message allocated on it until the call ends, i.e., memory
+  // grows with the number of requests read, hence for long lived
+  // streaming calls prefer 'Reader().Read()' or an arena of your
+  // own that you reset periodically.
+  google::protobuf::Arena* arena() {
+    if (!arena_) {
+      arena_ = std::make_unique<google::protobuf::Arena>();
+    }
+    return arena_.get();
+  }
+
   auto& Reader() {
     return reader_;
   }
@@ -429,6 +522,10 @@ class ServerCall {
   }
 
  private:
+  // NOTE: declared first so that it gets destructed last, i.e., after
+  // anything that might still refer to messages allocated on it.
+  std::unique_ptr<google::protobuf::Arena> arena_;
+
   std::unique_ptr<ServerContext> context_;
   ServerReader<RequestType_> reader_;
   ServerWriter<ResponseType_> writer_;
@@ -436,11 +533,16 @@ class ServerCall {
 
 ////////////////////////////////////////////////////////////////////////
 
-class Endpoint : public Synchronizable {
+class Endpoint final {
  public:
-  Endpoint(std::string&& path, std::string&& host)
+  Endpoint(
+      std::string&& path,
+      std::string&& host,
+      size_t capacity,
+      ChannelOverflow overflow)
     : path_(std::move(path)),
-      host_(std::move(host)) {}
+      host_(std::move(host)),
+      channel_(capacity, overflow) {}
 
   auto Enqueue(std::unique_ptr<ServerContext>&& context) {
     EVENTUALS_GRPC_LOG(1)
@@ -448,16 +550,37 @@ class Endpoint : public Synchronizable {
         << " for host = " << host_
         << " and path = " << path_;
 
-    return pipe_.Write(std::move(context));
+    return channel_.Write(std::move(context))
+        | Then([this](auto&& rejected) {
+             // Shed load by finishing the call if it was rejected
+             // because too many calls are already queued.
+             if (rejected) {
+               ServerContext* context = rejected->release();
+
+               EVENTUALS_GRPC_LOG(1)
+                   << "Rejecting call (" << context << ")"
+                   << " for host = " << host_
+                   << " and path = " << path_;
+
+               auto status = ::grpc::Status(
+                   ::grpc::RESOURCE_EXHAUSTED,
+                   "Too many queued calls for " + path_
+                       + " for host " + host_);
+
+               context->FinishThenOnDone(status, [context](bool) {
+                 delete context;
+               });
+             }
+           });
   }
 
   // NOTE: returns a stream rather than a single eventual context.
   auto Dequeue() {
-    return pipe_.Read();
+    return channel_.Read();
   }
 
   auto Shutdown() {
-    return pipe_.Close();
+    return channel_.Close();
   }
 
   const std::string& path() {
@@ -472,7 +595,7 @@ class Endpoint : public Synchronizable {
   const std::string path_;
   const std::string host_;
 
-  Pipe<std::unique_ptr<ServerContext>> pipe_;
+  Channel<std::unique_ptr<ServerContext>> channel_;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -527,7 +650,10 @@ class Server : public Synchronizable {
       std::unique_ptr<::grpc::AsyncGenericService>&& service,
       std::unique_ptr<::grpc::Server>&& server,
       std::vector<std::unique_ptr<::grpc::ServerCompletionQueue>>&& cqs,
-      std::vector<std::thread>&& threads);
+      std::vector<std::thread>&& threads,
+      size_t outstandingRequestsPerCompletionQueue,
+      size_t maximumQueuedCallsPerEndpoint,
+      ChannelOverflow queuedCallsOverflow);
 
   template <typename Request, typename Response>
   auto Validate(const std::string& name);
@@ -547,6 +673,9 @@ class Server : public Synchronizable {
   std::vector<std::unique_ptr<::grpc::ServerCompletionQueue>> cqs_;
   std::vector<std::thread> threads_;
 
+  const size_t maximumQueuedCallsPerEndpoint_;
+  const ChannelOverflow queuedCallsOverflow_;
+
   struct Serve {
     Service* service;
     Interrupt interrupt;
@@ -556,6 +685,10 @@ class Server : public Synchronizable {
 
   std::vector<std::unique_ptr<Serve>> serves_;
 
+  // NOTE: there are 'outstandingRequestsPerCompletionQueue' workers
+  // for each completion queue, each with their own 'RequestCall()'
+  // outstanding, so that accepting a call doesn't have to wait for
+  // a previously accepted call to be looked up and enqueued.
   struct Worker {
     Interrupt interrupt;
     std::optional<Task::Of<void>::With<::grpc::ServerCompletionQueue*>> task;
@@ -568,6 +701,26 @@ class Server : public Synchronizable {
       std::pair<std::string, std::string>,
       std::unique_ptr<Endpoint>>
       endpoints_;
+
+  // Immutable snapshot of 'endpoints_' used by 'Lookup()' to route
+  // each call without acquiring the lock. The keys are views of the
+  // path and host of each endpoint which live as long as the server.
+  using Routes = absl::flat_hash_map<
+      std::pair<std::string_view, std::string_view>,
+      Endpoint*>;
+
+  // NOTE: a new snapshot gets published by 'Insert()' every time an
+  // endpoint is added. Since 'Lookup()' might still be using a
+  // previous snapshot we don't free any of them until the server is
+  // destructed. This means that after adding 'n' endpoints we retain
+  // n * (n + 1) / 2 entries across all snapshots, e.g., ~500K entries
+  // (on the order of 25MB) for 1000 endpoints. That's fine because
+  // servers have a bounded (and usually small) number of endpoints
+  // that get added once (usually at startup) and it keeps 'Lookup()'
+  // from having to touch any shared state (like a reference count)
+  // for every call.
+  std::atomic<const Routes*> routes_ = nullptr;
+  std::vector<std::unique_ptr<const Routes>> snapshots_;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -586,6 +739,29 @@ class ServerBuilder {
   // TODO(benh): Provide a 'setMaximumThreadsPerCompletionQueue' as well.
   ServerBuilder& SetMinimumThreadsPerCompletionQueue(size_t n);
 
+  // Sets the number of calls that can be requested (i.e., waiting to
+  // be accepted) at the same time for each completion queue, default
+  // is 1. Larger values let the server accept bursts of new calls
+  // without serializing on each accepted call.
+  ServerBuilder& SetOutstandingRequestsPerCompletionQueue(size_t n);
+
+  // Sets the maximum number of accepted calls that can be queued for
+  // each endpoint (i.e., waiting for the next 'Accept()'), by default
+  // there is no maximum. The 'overflow' determines what happens once
+  // the maximum is reached: either we wait to accept more calls or we
+  // finish any calls beyond the maximum with 'RESOURCE_EXHAUSTED'.
+  //
+  // NOTE: 'n' gets rounded up to the next power of 2 (and is at least
+  // 2), see 'Channel', so the effective maximum might be larger than
+  // 'n', e.g., 100 allows queueing 128 calls.
+  //
+  // NOTE: waiting to accept more calls for one endpoint means waiting
+  // to accept calls for _every_ endpoint that uses the same completion
+  // queue, i.e., one slow endpoint can block the others.
+  ServerBuilder& SetMaximumQueuedCallsPerEndpoint(
+      size_t n,
+      ChannelOverflow overflow = ChannelOverflow::Block);
+
   ServerBuilder& AddListeningPort(
       const std::string& address,
       std::shared_ptr<::grpc::ServerCredentials> credentials,
@@ -599,6 +775,9 @@ class ServerBuilder {
   ServerStatus status_ = ServerStatus::Ok();
   std::optional<size_t> numberOfCompletionQueues_;
   std::optional<size_t> minimumThreadsPerCompletionQueue_;
+  std::optional<size_t> outstandingRequestsPerCompletionQueue_;
+  std::optional<size_t> maximumQueuedCallsPerEndpoint_;
+  ChannelOverflow queuedCallsOverflow_ = ChannelOverflow::Block;
   std::vector<std::string> addresses_;
   std::vector<Service*> services_;
 
@@ -609,14 +788,23 @@ class ServerBuilder {
 
 template <typename Request, typename Response>
 auto Server::Validate(const std::string& name) {
-  const auto* method =
-      google::protobuf::DescriptorPool::generated_pool()
-          ->FindMethodByName(name);
+  // See comment on 'RawBytes' for why we don't validate.
+  constexpr bool validate =
+      !IsRawBytes<Request>::value && !IsRawBytes<Response>::value;
+
+  const google::protobuf::MethodDescriptor* method = nullptr;
+
+  if constexpr (validate) {
+    method = google::protobuf::DescriptorPool::generated_pool()
+                 ->FindMethodByName(name);
+  }
 
   return Eventual<void>()
       .raises<std::runtime_error>()
       .start([method](auto& k) {
-        if (method == nullptr) {
+        if constexpr (!validate) {
+          k.Start();
+        } else if (method == nullptr) {
           k.Fail(std::runtime_error("Method not found"));
         } else {
           using Traits = RequestResponseTraits;
@@ -647,6 +835,20 @@ inline auto Server::Insert(std::unique_ptr<Endpoint>&& endpoint) {
                   "Already serving " + endpoint->path()
                   + " for host " + endpoint->host()));
             } else {
+              // Publish a new snapshot of the routes, see 'routes_'.
+              auto routes = std::make_unique<Routes>();
+              routes->reserve(endpoints_.size());
+              for (auto& [_, endpoint] : endpoints_) {
+                routes->emplace(
+                    std::make_pair(
+                        std::string_view(endpoint->path()),
+                        std::string_view(endpoint->host())),
+                    endpoint.get());
+              }
+
+              routes_.store(routes.get(), std::memory_order_release);
+              snapshots_.push_back(std::move(routes));
+
               EVENTUALS_GRPC_LOG(1)
                   << "Serving endpoint"
                   << " for host = " << key.second
@@ -699,7 +901,11 @@ auto Server::Accept(std::string name, std::string host) {
   size_t index = path.find_last_of(".");
   path.replace(index, 1, "/");
 
-  auto endpoint = std::make_unique<Endpoint>(std::move(path), std::move(host));
+  auto endpoint = std::make_unique<Endpoint>(
+      std::move(path),
+      std::move(host),
+      maximumQueuedCallsPerEndpoint_,
+      queuedCallsOverflow_);
 
   // NOTE: we need a generic/untyped "server context" object to be
   // able to store generic/untyped "endpoints" but we want to expose
@@ -774,6 +980,26 @@ auto StreamingEpilogue(ServerCall<Request, Response>& call) {
 
 ////////////////////////////////////////////////////////////////////////
 
+// Like 'StreamingEpilogue()' above but lets gRPC coalesce responses
+// as determined by 'buffering', see 'ServerWriter::WriteMany()'.
+template <typename Request, typename Response>
+auto StreamingEpilogue(
+    ServerCall<Request, Response>& call,
+    WriteBuffering buffering) {
+  return call.Writer().WriteMany(buffering)
+      | Just(::grpc::Status::OK)
+      | Catch()
+            .raised<std::exception>([](std::exception&& e) {
+              return ::grpc::Status(::grpc::UNKNOWN, e.what());
+            })
+      | Then([&](auto&& status) {
+           return call.Finish(status)
+               | call.WaitForDone();
+         });
+}
+
+////////////////////////////////////////////////////////////////////////
+
 } // namespace grpc
 } // namespace eventuals
 
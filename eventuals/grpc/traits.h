@@ -2,10 +2,12 @@
 
 #include <optional>
 #include <string>
+#include <type_traits>
 
 #include "eventuals/grpc/call-type.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/message_lite.h"
+#include "grpcpp/support/byte_buffer.h"
 
 ////////////////////////////////////////////////////////////////////////
 
@@ -20,6 +22,18 @@ struct Stream {};
 
 ////////////////////////////////////////////////////////////////////////
 
+// Used in place of protobuf message types for requests and/or
+// responses in order to read and write the serialized bytes of each
+// message as is, i.e., without parsing or serializing, which is
+// useful for proxying calls. The bytes are held in slices which get
+// reference counted rather than copied when moved between calls.
+//
+// NOTE: methods with 'RawBytes' requests or responses don't get
+// validated since they might not be known to this process.
+using RawBytes = ::grpc::ByteBuffer;
+
+////////////////////////////////////////////////////////////////////////
+
 template <typename T>
 class IsService {
  private:
@@ -42,10 +56,46 @@ template <typename T>
 struct IsMessage
   : std::is_base_of<google::protobuf::MessageLite, T> {};
 
+template <typename T>
+struct IsMessage<Stream<T>> : IsMessage<T> {};
+
+template <>
+struct IsMessage<RawBytes> : std::true_type {};
+
+////////////////////////////////////////////////////////////////////////
 
 template <typename T>
-struct IsMessage<Stream<T>>
-  : std::is_base_of<google::protobuf::MessageLite, T> {};
+struct IsRawBytes : std::is_same<RawBytes, T> {};
+
+template <typename T>
+struct IsRawBytes<Stream<T>> : IsRawBytes<T> {};
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns a string for logging 'message'.
+template <typename T>
+std::string DebugString(const T& message) {
+  if constexpr (IsRawBytes<T>::value) {
+    return std::to_string(message.Length()) + " raw bytes";
+  } else {
+    return message.DebugString();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns the serialized size of 'message'.
+//
+// NOTE: protobuf caches the size so computing it before serializing
+// doesn't require any extra work when serializing.
+template <typename T>
+size_t MessageSize(const T& message) {
+  if constexpr (IsRawBytes<T>::value) {
+    return message.Length();
+  } else {
+    return message.ByteSizeLong();
+  }
+}
 
 ////////////////////////////////////////////////////////////////////////
 
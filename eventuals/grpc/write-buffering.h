@@ -0,0 +1,461 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+#include "eventuals/callback.h"
+#include "eventuals/closure.h"
+#include "eventuals/eventual.h"
+#include "eventuals/grpc/traits.h"
+#include "eventuals/loop.h"
+#include "eventuals/map.h"
+#include "eventuals/terminal.h"
+#include "eventuals/then.h"
+#include "grpcpp/alarm.h"
+#include "grpcpp/impl/codegen/call_op_set.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+namespace grpc {
+
+////////////////////////////////////////////////////////////////////////
+
+// Determines how many messages written via 'WriteMany()' (see
+// 'ServerWriter' and 'ClientWriter') gRPC may buffer before they must
+// be flushed to the network.
+struct WriteBuffering {
+  // Flush after this many messages.
+  size_t messages = 64;
+
+  // Flush after this many bytes.
+  size_t bytes = 64 * 1024;
+
+  // Flush once the oldest message that hasn't been flushed has been
+  // waiting this long, even if no more messages get written.
+  std::chrono::steady_clock::duration delay = std::chrono::milliseconds(5);
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Helper that returns the '::grpc::WriteOptions' for each message
+// written via 'WriteMany()', i.e., setting the buffer hint so gRPC
+// can coalesce them unless 'WriteBuffering' says to flush.
+class WriteCoalescer final {
+ public:
+  WriteCoalescer(WriteBuffering buffering)
+    : buffering_(buffering) {}
+
+  // Records that a message is waiting to be written at 'now',
+  // starting the delay if it's the first message since a flush.
+  void Hold(std::chrono::steady_clock::time_point now) {
+    if (!since_) {
+      since_ = now;
+    }
+  }
+
+  // Returns the options for writing a message of 'size' bytes when
+  // there is another message after it (which will be written later).
+  ::grpc::WriteOptions Next(
+      size_t size,
+      std::chrono::steady_clock::time_point now) {
+    messages_ += 1;
+    bytes_ += size;
+
+    if (messages_ >= buffering_.messages
+        || bytes_ >= buffering_.bytes
+        || now >= Deadline()) {
+      Flushed();
+      return ::grpc::WriteOptions();
+    } else {
+      return ::grpc::WriteOptions().set_buffer_hint();
+    }
+  }
+
+  // Records that a message was written without the buffer hint which
+  // flushes everything buffered before it.
+  void Flushed() {
+    messages_ = 0;
+    bytes_ = 0;
+    since_.reset();
+  }
+
+  // Returns when everything not yet flushed must be flushed.
+  std::chrono::steady_clock::time_point Deadline() const {
+    CHECK(since_);
+    return *since_ + buffering_.delay;
+  }
+
+ private:
+  const WriteBuffering buffering_;
+
+  size_t messages_ = 0;
+  size_t bytes_ = 0;
+
+  // When the oldest message that hasn't been flushed was held.
+  std::optional<std::chrono::steady_clock::time_point> since_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// State for 'CoalescedWrites()'.
+//
+// We always hold back the last message rather than writing it right
+// away so that we can decide to write it with or without the buffer
+// hint once we know whether or not another message follows it. If no
+// message follows it before the deadline determined by the delay of
+// 'WriteBuffering' an alarm writes it without the buffer hint, which
+// flushes it along with everything buffered before it. Thus anything
+// gRPC buffers always has a held message (and an alarm) behind it.
+//
+// If the stream of messages fails or is stopped we discard any held
+// message and wait for any outstanding write before propagating the
+// failure (or stop), see 'Abort()', so that nothing gets written after
+// the call has been finished.
+//
+// NOTE: a 'std::shared_ptr' because the alarm might still invoke its
+// callback after we've been aborted (it can be cancelled but it's
+// still invoked), at which point the writer that 'write' refers to
+// may have been destructed, hence we never write after aborting.
+template <typename Message_>
+class _CoalescedWrites final
+  : public std::enable_shared_from_this<_CoalescedWrites<Message_>> {
+ public:
+  // Writes a message with the options using the callback as the tag.
+  using Write_ = Callback<void(
+      const Message_&,
+      ::grpc::WriteOptions,
+      Callback<void(bool)>*)>;
+
+  _CoalescedWrites(WriteBuffering buffering, Write_ write)
+    : coalescer_(buffering),
+      write_(std::move(write)) {
+    written_ = [this](bool ok) {
+      Written(ok);
+    };
+  }
+
+  // Holds 'message' invoking 'k' once it's safe to provide another
+  // message (i.e., after writing the previously held message, if
+  // any) or with false if a write failed.
+  void Next(Message_ message, Callback<void(bool)> k) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    CHECK(!k_ && !waiting_);
+
+    if (failed_) {
+      lock.unlock();
+      k(false);
+    } else if (writing_) {
+      // Wait until the write from the alarm has completed.
+      waiting_.emplace(std::move(message));
+      k_ = std::move(k);
+    } else {
+      Hold(std::move(message), std::move(k), lock);
+    }
+  }
+
+  // Writes the held message, if any, without the buffer hint and then
+  // invokes 'k', i.e., after there are no more messages.
+  void Flush(Callback<void(bool)> k) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    CHECK(!k_ && !flush_);
+
+    ended_ = true;
+
+    if (alarm_ && armed_) {
+      alarm_->Cancel();
+    }
+
+    if (writing_) {
+      flush_ = std::move(k);
+    } else {
+      FlushHeld(std::move(k), lock);
+    }
+  }
+
+  // Discards any held (or waiting) message and then invokes 'k' once
+  // there isn't an outstanding write, i.e., after the stream of
+  // messages has failed or been stopped.
+  void Abort(Callback<void()> k) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    ended_ = true;
+
+    held_.reset();
+    waiting_.reset();
+
+    if (alarm_ && armed_) {
+      alarm_->Cancel();
+    }
+
+    if (writing_) {
+      CHECK(!aborted_);
+      aborted_ = std::move(k);
+    } else {
+      lock.unlock();
+      k();
+    }
+  }
+
+ private:
+  // NOTE: expects 'lock' to be locked and unlocks it.
+  void Hold(
+      Message_ message,
+      Callback<void(bool)> k,
+      std::unique_lock<std::mutex>& lock) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (!held_) {
+      held_.emplace(std::move(message));
+      coalescer_.Hold(now);
+      Arm();
+      lock.unlock();
+      k(true);
+    } else {
+      Message_ previous = std::move(*held_);
+      held_.emplace(std::move(message));
+      auto options = coalescer_.Next(MessageSize(previous), now);
+      coalescer_.Hold(now);
+      k_ = std::move(k);
+      Write(std::move(previous), std::move(options), lock);
+    }
+  }
+
+  // NOTE: expects 'lock' to be locked and unlocks it.
+  void FlushHeld(Callback<void(bool)> k, std::unique_lock<std::mutex>& lock) {
+    if (failed_ || !held_) {
+      bool ok = !failed_;
+      lock.unlock();
+      k(ok);
+    } else {
+      Message_ message = std::move(*held_);
+      held_.reset();
+      coalescer_.Flushed();
+      k_ = std::move(k);
+      Write(std::move(message), ::grpc::WriteOptions(), lock);
+    }
+  }
+
+  // NOTE: expects 'lock' to be locked and unlocks it.
+  void Write(
+      Message_ message,
+      ::grpc::WriteOptions options,
+      std::unique_lock<std::mutex>& lock) {
+    CHECK(!writing_);
+    writing_ = true;
+
+    // Keep ourselves alive until the write has completed.
+    self_ = this->shared_from_this();
+
+    lock.unlock();
+
+    write_(message, std::move(options), &written_);
+  }
+
+  void Written(bool ok) {
+    // NOTE: might be the last reference to us so we release it only
+    // once we've returned (and thus after unlocking 'mutex_'). Safe
+    // to take without holding 'mutex_' since nothing else touches
+    // 'self_' while writing.
+    auto self = std::move(self_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    CHECK(writing_);
+    writing_ = false;
+
+    if (!ok) {
+      failed_ = true;
+    }
+
+    if (held_ && !ended_) {
+      Arm();
+    }
+
+    if (aborted_) {
+      auto k = std::move(aborted_);
+      lock.unlock();
+      k();
+    } else if (waiting_) {
+      // A message was provided while the alarm was writing.
+      Message_ message = std::move(*waiting_);
+      waiting_.reset();
+      auto k = std::move(k_);
+      if (failed_) {
+        lock.unlock();
+        k(false);
+      } else {
+        Hold(std::move(message), std::move(k), lock);
+      }
+    } else if (flush_) {
+      // Flushing while the alarm was writing.
+      FlushHeld(std::move(flush_), lock);
+    } else if (k_) {
+      auto k = std::move(k_);
+      lock.unlock();
+      k(!failed_);
+    }
+  }
+
+  // Arms the alarm for the deadline of the held message unless the
+  // alarm is already armed.
+  //
+  // NOTE: expects to be called while holding 'mutex_'.
+  void Arm() {
+    if (armed_) {
+      return;
+    }
+
+    armed_ = true;
+
+    auto timeout = coalescer_.Deadline() - std::chrono::steady_clock::now();
+
+    // NOTE: a new alarm each time since we only arm after the last
+    // alarm has expired, which is at most once per delay.
+    alarm_ = std::make_unique<::grpc::Alarm>();
+
+    alarm_->Set(
+        gpr_time_add(
+            gpr_now(GPR_CLOCK_MONOTONIC),
+            gpr_time_from_nanos(
+                std::max<int64_t>(
+                    0,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        timeout)
+                        .count()),
+                GPR_TIMESPAN)),
+        [weak = this->weak_from_this()](bool ok) {
+          // NOTE: we might have been destructed, e.g., if the stream
+          // of messages failed, in which case there is nothing to do.
+          if (auto self = weak.lock()) {
+            self->Expired(ok);
+          }
+        });
+  }
+
+  void Expired(bool ok) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    armed_ = false;
+
+    if (!ok || ended_ || !held_) {
+      // Cancelled or nothing to flush.
+      return;
+    } else if (writing_) {
+      // We'll rearm once the write has completed, see 'Written()'.
+      return;
+    } else if (std::chrono::steady_clock::now() < coalescer_.Deadline()) {
+      Arm();
+    } else {
+      Message_ message = std::move(*held_);
+      held_.reset();
+      coalescer_.Flushed();
+      Write(std::move(message), ::grpc::WriteOptions(), lock);
+    }
+  }
+
+  std::mutex mutex_;
+
+  WriteCoalescer coalescer_;
+
+  Write_ write_;
+
+  // Last message we've been given but not yet written.
+  std::optional<Message_> held_;
+
+  // Message we've been given while the alarm was writing.
+  std::optional<Message_> waiting_;
+
+  // Continuation for 'Next()' or 'Flush()' waiting for a write.
+  Callback<void(bool)> k_;
+
+  // Continuation for 'Flush()' waiting for the alarm's write.
+  Callback<void(bool)> flush_;
+
+  // Continuation for 'Abort()' waiting for an outstanding write.
+  Callback<void()> aborted_;
+
+  Callback<void(bool)> written_;
+
+  std::shared_ptr<_CoalescedWrites> self_;
+
+  std::unique_ptr<::grpc::Alarm> alarm_;
+
+  bool armed_ = false;
+  bool writing_ = false;
+  bool ended_ = false;
+  bool failed_ = false;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns a stream consumer that writes each message of the stream
+// it gets composed with using 'write' as determined by 'buffering',
+// see '_CoalescedWrites' and 'ServerWriter::WriteMany()' and
+// 'ClientWriter::WriteMany()'.
+template <typename Message_>
+auto CoalescedWrites(
+    WriteBuffering buffering,
+    typename _CoalescedWrites<Message_>::Write_ write) {
+  return Closure([writes = std::make_shared<_CoalescedWrites<Message_>>(
+                      buffering,
+                      std::move(write))]() {
+    return Map([&writes](auto&& message) {
+             return Eventual<void>()
+                 .raises<std::runtime_error>()
+                 .start([&writes,
+                         message = Message_(
+                             std::forward<decltype(message)>(message))](
+                            auto& k) mutable {
+                   writes->Next(std::move(message), [&k](bool ok) {
+                     if (ok) {
+                       k.Start();
+                     } else {
+                       k.Fail(std::runtime_error("Failed to write"));
+                     }
+                   });
+                 });
+           })
+        | Loop()
+              .fail([&writes](auto& k, auto&& error) {
+                writes->Abort(
+                    [&k,
+                     e = make_exception_ptr_or_forward(
+                         std::forward<decltype(error)>(error))]() mutable {
+                      k.Fail(std::move(e));
+                    });
+              })
+              .stop([&writes](auto& k) {
+                writes->Abort([&k]() {
+                  k.Stop();
+                });
+              })
+        | Then([&writes]() {
+             return Eventual<void>()
+                 .raises<std::runtime_error>()
+                 .start([&writes](auto& k) {
+                   writes->Flush([&k](bool ok) {
+                     if (ok) {
+                       k.Start();
+                     } else {
+                       k.Fail(std::runtime_error("Failed to write"));
+                     }
+                   });
+                 });
+           });
+  });
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace grpc
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
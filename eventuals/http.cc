@@ -1,5 +1,8 @@
 #include "eventuals/http.h"
 
+#include <algorithm>
+#include <cstring> // For 'memcpy()'.
+
 ////////////////////////////////////////////////////////////////////////
 
 class CURLGlobalInitializer final {
@@ -16,3 +19,905 @@ class CURLGlobalInitializer final {
 static CURLGlobalInitializer initializer_;
 
 ////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+namespace http {
+
+////////////////////////////////////////////////////////////////////////
+
+// Helpers for case insensitive hashing and comparing of header names,
+// which are always ASCII.
+static inline char ToLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// FNV-1a.
+static inline size_t Hash(std::string_view key) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : key) {
+    hash ^= static_cast<unsigned char>(ToLower(c));
+    hash *= 1099511628211ull;
+  }
+  return static_cast<size_t>(hash);
+}
+
+static inline bool Equals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (ToLower(a[i]) != ToLower(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static inline std::string_view Trim(std::string_view s) {
+  while (!s.empty() && IsSpace(s.front())) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && IsSpace(s.back())) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+HeaderTable::HeaderTable(std::string&& raw)
+  : raw_(std::move(raw)) {
+  // Size everything up front based on the number of lines, which is
+  // an upper bound on the number of headers, so that we don't have to
+  // grow (or rehash) while parsing.
+  size_t lines = std::count(raw_.begin(), raw_.end(), '\n') + 1;
+
+  entries_.reserve(lines);
+
+  size_t slots = 8;
+  while (slots < 2 * lines) {
+    slots *= 2;
+  }
+
+  slots_.resize(slots, 0);
+
+  std::string_view remaining = raw_;
+
+  while (!remaining.empty()) {
+    size_t end = remaining.find('\n');
+    std::string_view line = remaining.substr(0, end);
+    remaining.remove_prefix(
+        end == std::string_view::npos ? remaining.size() : end + 1);
+
+    // Skip lines like 'HTTP/1.1 200' that aren't headers.
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos) {
+      continue;
+    }
+
+    std::string_view key = Trim(line.substr(0, colon));
+    std::string_view value = Trim(line.substr(colon + 1));
+
+    if (key.empty()) {
+      continue;
+    }
+
+    size_t slot = Probe(key);
+
+    if (slots_[slot] == 0) {
+      entries_.push_back(Entry{
+          static_cast<uint32_t>(key.data() - raw_.data()),
+          static_cast<uint32_t>(key.size()),
+          static_cast<uint32_t>(value.data() - raw_.data()),
+          static_cast<uint32_t>(value.size()),
+          false});
+      slots_[slot] = static_cast<uint32_t>(entries_.size());
+    } else {
+      // RFC 7230, section 3.2.2:
+      // A recipient MAY combine multiple header fields
+      // with the same field name into one
+      // "field-name: field-value" pair, without changing
+      // the semantics of the message, by appending each
+      // subsequent field value to the combined field
+      // value in order, separated by a comma.
+      //
+      // NOTE: we append the combined value to the end of 'combined_'
+      // (rather than updating it in place) which leaves behind any
+      // previously combined value but keeps things simple given
+      // how rare it is to receive the same header more than twice.
+      Entry& entry = entries_[slots_[slot] - 1];
+
+      size_t offset = combined_.size();
+
+      // NOTE: the previous value might be a view into 'combined_' so
+      // we must reserve before we get it and append it to itself.
+      combined_.reserve(offset + entry.value_size + 2 + value.size());
+
+      std::string_view previous = Get(entry).second;
+
+      combined_.append(previous.data(), previous.size());
+      combined_.append(", ");
+      combined_.append(value.data(), value.size());
+
+      entry.value_offset = static_cast<uint32_t>(offset);
+      entry.value_size = static_cast<uint32_t>(combined_.size() - offset);
+      entry.combined = true;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::optional<std::string_view> HeaderTable::Find(
+    std::string_view key) const {
+  if (slots_.empty()) {
+    return std::nullopt;
+  }
+
+  size_t slot = Probe(key);
+
+  if (slots_[slot] == 0) {
+    return std::nullopt;
+  }
+
+  return Get(entries_[slots_[slot] - 1]).second;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+HeaderTable::value_type HeaderTable::Get(const Entry& entry) const {
+  const std::string& values = entry.combined ? combined_ : raw_;
+  return value_type(
+      std::string_view(raw_).substr(entry.key_offset, entry.key_size),
+      std::string_view(values).substr(entry.value_offset, entry.value_size));
+}
+
+////////////////////////////////////////////////////////////////////////
+
+size_t HeaderTable::Probe(std::string_view key) const {
+  // NOTE: 'slots_' is always at least twice as big as the number of
+  // entries so there is always an empty slot to stop at.
+  size_t mask = slots_.size() - 1;
+  size_t slot = Hash(key) & mask;
+  while (slots_[slot] != 0) {
+    const Entry& entry = entries_[slots_[slot] - 1];
+    if (Equals(key, std::string_view(raw_).substr(
+                        entry.key_offset,
+                        entry.key_size))) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+_ConnectionPool::_ConnectionPool(
+    size_t size,
+    std::optional<std::chrono::nanoseconds> idle_timeout,
+    bool http2,
+    size_t max_concurrent_streams)
+  : size_(size),
+    idle_timeout_(std::move(idle_timeout)),
+    http2_(http2),
+    multi_(CHECK_NOTNULL(curl_multi_init())),
+    share_(CHECK_NOTNULL(curl_share_init())) {
+  CHECK_EQ(
+      curl_multi_setopt(multi_, CURLMOPT_SOCKETDATA, this),
+      CURLM_OK);
+  CHECK_EQ(
+      curl_multi_setopt(multi_, CURLMOPT_SOCKETFUNCTION, SocketFunction),
+      CURLM_OK);
+  CHECK_EQ(
+      curl_multi_setopt(multi_, CURLMOPT_TIMERDATA, this),
+      CURLM_OK);
+  CHECK_EQ(
+      curl_multi_setopt(multi_, CURLMOPT_TIMERFUNCTION, TimerFunction),
+      CURLM_OK);
+  CHECK_EQ(
+      curl_multi_setopt(multi_, CURLMOPT_MAXCONNECTS, (long) size_),
+      CURLM_OK);
+
+  if (http2_) {
+    CHECK_EQ(
+        curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX),
+        CURLM_OK);
+    CHECK_EQ(
+        curl_multi_setopt(
+            multi_,
+            CURLMOPT_MAX_CONCURRENT_STREAMS,
+            (long) max_concurrent_streams),
+        CURLM_OK);
+  }
+
+  // NOTE: connections are already shared by all easy handles added
+  // to the same multi handle, but DNS and TLS sessions are only
+  // shared via a share handle. We don't need to set any lock
+  // functions because we only ever use the handles from within the
+  // event loop.
+  CHECK_EQ(
+      curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS),
+      CURLSHE_OK);
+  CHECK_EQ(
+      curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION),
+      CURLSHE_OK);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+_ConnectionPool::~_ConnectionPool() {
+  CHECK_EQ(transfers_, 0u) << "destructing pool with outstanding transfers";
+
+  // Should have been closed by 'Idle()'.
+  CHECK(timer_ == nullptr);
+  CHECK(polls_.empty());
+
+  // NOTE: libcurl may invoke the socket and timer functions while
+  // cleaning up but there isn't anything for us to do anymore.
+  curl_multi_setopt(multi_, CURLMOPT_SOCKETFUNCTION, nullptr);
+  curl_multi_setopt(multi_, CURLMOPT_TIMERFUNCTION, nullptr);
+
+  for (CURL* easy : easies_) {
+    curl_easy_cleanup(easy);
+  }
+
+  curl_multi_cleanup(multi_);
+
+  // NOTE: must be done after all the easy handles using it have been
+  // cleaned up.
+  curl_share_cleanup(share_);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+CURL* _ConnectionPool::Acquire(EventLoop& loop) {
+  CHECK(loop_ == nullptr || loop_ == &loop)
+      << "all requests from the same client must use the same event loop,"
+      << " see 'Client::Builder().loop()'";
+
+  loop_ = &loop;
+
+  CURL* easy = nullptr;
+
+  if (!easies_.empty()) {
+    easy = easies_.back();
+    easies_.pop_back();
+  } else {
+    easy = CHECK_NOTNULL(curl_easy_init());
+  }
+
+  CHECK_EQ(curl_easy_setopt(easy, CURLOPT_SHARE, share_), CURLE_OK);
+
+  if (http2_) {
+    CHECK_EQ(
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS),
+        CURLE_OK);
+
+    // NOTE: without 'CURLOPT_PIPEWAIT' concurrent requests made
+    // before the first connection has been established (and
+    // negotiated HTTP/2) would each open their own connection.
+    CHECK_EQ(curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L), CURLE_OK);
+  }
+
+  if (idle_timeout_) {
+    CHECK_EQ(
+        curl_easy_setopt(
+            easy,
+            CURLOPT_MAXAGE_CONN,
+            (long) std::chrono::duration_cast<std::chrono::seconds>(
+                *idle_timeout_)
+                .count()),
+        CURLE_OK);
+  }
+
+  return easy;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _ConnectionPool::Release(CURL* easy) {
+  // NOTE: resetting keeps any live connections as well as the DNS
+  // and TLS session caches, it only resets the options.
+  curl_easy_reset(easy);
+
+  if (easies_.size() < size_) {
+    easies_.push_back(easy);
+  } else {
+    curl_easy_cleanup(easy);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _ConnectionPool::Add(CURL* easy, Callback<void(CURLcode)>* done) {
+  CHECK_EQ(curl_easy_setopt(easy, CURLOPT_PRIVATE, done), CURLE_OK);
+
+  transfers_++;
+
+  CHECK_EQ(curl_multi_add_handle(multi_, easy), CURLM_OK);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _ConnectionPool::Remove(CURL* easy) {
+  CHECK_EQ(curl_multi_remove_handle(multi_, easy), CURLM_OK);
+
+  transfers_--;
+
+  Idle();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+int _ConnectionPool::SocketFunction(
+    CURL* easy,
+    curl_socket_t socket,
+    int what,
+    void* data,
+    void* poll) {
+  auto& pool = *static_cast<_ConnectionPool*>(data);
+
+  if (what == CURL_POLL_REMOVE) {
+    // NOTE: 'poll' might be nullptr if we already closed it because
+    // we became idle, see 'Idle()'.
+    if (poll != nullptr) {
+      pool.polls_.erase(
+          std::find(pool.polls_.begin(), pool.polls_.end(), poll));
+
+      uv_poll_stop(static_cast<uv_poll_t*>(poll));
+      uv_close(
+          static_cast<uv_handle_t*>(poll),
+          [](uv_handle_t* handle) {
+            delete (uv_poll_t*) handle;
+          });
+
+      curl_multi_assign(pool.multi_, socket, nullptr);
+    }
+    return 0;
+  }
+
+  if (poll == nullptr) {
+    // Don't start polling if we're idle, see 'Idle()'.
+    if (pool.transfers_ == 0) {
+      return 0;
+    }
+
+    poll = new uv_poll_t();
+
+    CHECK_EQ(
+        uv_poll_init_socket(
+            *pool.loop_,
+            static_cast<uv_poll_t*>(poll),
+            socket),
+        0);
+
+    uv_handle_set_data(static_cast<uv_handle_t*>(poll), &pool);
+
+    pool.polls_.push_back(static_cast<uv_poll_t*>(poll));
+
+    // Assign the poll handle so that we get it back as 'poll' the
+    // next time we're called for this socket.
+    CHECK_EQ(curl_multi_assign(pool.multi_, socket, poll), CURLM_OK);
+  }
+
+  int events = 0;
+  if (what & CURL_POLL_IN) {
+    events |= UV_READABLE;
+  }
+  if (what & CURL_POLL_OUT) {
+    events |= UV_WRITABLE;
+  }
+
+  // NOTE: starting an already started poll handle just updates
+  // the events that it is polling for.
+  CHECK_EQ(
+      uv_poll_start(
+          static_cast<uv_poll_t*>(poll),
+          events,
+          [](uv_poll_t* poll, int status, int events) {
+            auto& pool = *(_ConnectionPool*) poll->data;
+
+            int flags = 0;
+            if (status < 0) {
+              flags = CURL_CSELECT_ERR;
+            }
+            if (status == 0 && (events & UV_READABLE)) {
+              flags |= CURL_CSELECT_IN;
+            }
+            if (status == 0 && (events & UV_WRITABLE)) {
+              flags |= CURL_CSELECT_OUT;
+            }
+
+            // Getting underlying socket desriptor from poll handle.
+            uv_os_fd_t socket;
+            uv_fileno((uv_handle_t*) poll, &socket);
+
+            // Stores the amount of running easy handles, unused
+            // since we use 'transfers_' instead.
+            int running_handles = 0;
+
+            // Perform an action for only this particular socket.
+            curl_multi_socket_action(
+                pool.multi_,
+                (curl_socket_t) socket,
+                flags,
+                &running_handles);
+
+            pool.Check();
+          }),
+      0);
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+int _ConnectionPool::TimerFunction(
+    CURLM* multi,
+    long timeout_ms,
+    void* data) {
+  auto& pool = *static_cast<_ConnectionPool*>(data);
+
+  if (timeout_ms < 0) {
+    if (pool.timer_ != nullptr) {
+      uv_timer_stop(pool.timer_);
+    }
+    return 0;
+  }
+
+  if (pool.timer_ == nullptr) {
+    // Don't start a timer if we're idle, see 'Idle()'.
+    if (pool.transfers_ == 0) {
+      return 0;
+    }
+
+    pool.timer_ = new uv_timer_t();
+    CHECK_EQ(0, uv_timer_init(*pool.loop_, pool.timer_));
+    uv_handle_set_data((uv_handle_t*) pool.timer_, &pool);
+  }
+
+  uv_timer_start(
+      pool.timer_,
+      [](uv_timer_t* timer) {
+        auto& pool = *(_ConnectionPool*) timer->data;
+
+        // Stores the amount of running easy handles, unused since we
+        // use 'transfers_' instead.
+        int running_handles = 0;
+
+        // Called with 'CURL_SOCKET_TIMEOUT' to let libcurl handle
+        // all of its timeouts.
+        curl_multi_socket_action(
+            pool.multi_,
+            CURL_SOCKET_TIMEOUT,
+            0,
+            &running_handles);
+
+        pool.Check();
+      },
+      timeout_ms,
+      /* repeat = */ 0);
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _ConnectionPool::Check() {
+  // NOTE: invoking 'done' might cause the last reference to this pool
+  // to go away (e.g., the client and the transfer get deallocated)
+  // so we hold on to a reference until we're finished.
+  std::shared_ptr<_ConnectionPool> self;
+
+  int messages = 0;
+  while (CURLMsg* message = curl_multi_info_read(multi_, &messages)) {
+    if (message->msg != CURLMSG_DONE) {
+      continue;
+    }
+
+    if (!self) {
+      self = shared_from_this();
+    }
+
+    // NOTE: 'message' is invalid after removing the easy handle.
+    CURL* easy = message->easy_handle;
+    CURLcode result = message->data.result;
+
+    Callback<void(CURLcode)>* done = nullptr;
+    CHECK_EQ(curl_easy_getinfo(easy, CURLINFO_PRIVATE, &done), CURLE_OK);
+
+    CHECK_EQ(curl_multi_remove_handle(multi_, easy), CURLM_OK);
+
+    transfers_--;
+
+    (*CHECK_NOTNULL(done))(result);
+  }
+
+  Idle();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _ConnectionPool::Idle() {
+  if (transfers_ > 0) {
+    return;
+  }
+
+  if (timer_ != nullptr) {
+    uv_timer_stop(timer_);
+    uv_close(
+        (uv_handle_t*) timer_,
+        [](uv_handle_t* handle) {
+          delete (uv_timer_t*) handle;
+        });
+    timer_ = nullptr;
+  }
+
+  // NOTE: libcurl doesn't poll idle connections but it might still
+  // have some sockets for connections that it is closing. We
+  // unassign each poll handle so that if libcurl calls us back for
+  // one of these sockets we'll just create a new poll handle.
+  for (auto* poll : polls_) {
+    uv_os_fd_t socket;
+    uv_fileno((uv_handle_t*) poll, &socket);
+
+    curl_multi_assign(multi_, (curl_socket_t) socket, nullptr);
+
+    uv_poll_stop(poll);
+    uv_close(
+        (uv_handle_t*) poll,
+        [](uv_handle_t* handle) {
+          delete (uv_poll_t*) handle;
+        });
+  }
+
+  polls_.clear();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool _Options::Set(CURL* easy, Request& request) {
+  // If applicable, PEM encode any certificate now before we start
+  // anything and can easily propagate an error.
+  const auto& certificate = request.certificate();
+  if (certificate) {
+    auto pem_certificate = pem::Encode(x509::Certificate(*certificate));
+
+    if (!pem_certificate) {
+      return false;
+    } else {
+      curl_blob blob;
+      blob.data = pem_certificate->data();
+      blob.len = pem_certificate->size();
+      blob.flags = CURL_BLOB_COPY;
+      CHECK_EQ(
+          curl_easy_setopt(easy, CURLOPT_CAINFO_BLOB, &blob),
+          CURLE_OK);
+    }
+  }
+
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+
+  // CURL easy options.
+  if (request.verify_peer()) {
+    CHECK_EQ(
+        curl_easy_setopt(
+            easy,
+            CURLOPT_SSL_VERIFYPEER,
+            request.verify_peer().value()),
+        CURLE_OK);
+  }
+
+  switch (request.method()) {
+    case Method::GET:
+      CHECK_EQ(
+          curl_easy_setopt(easy, CURLOPT_HTTPGET, 1),
+          CURLE_OK);
+      break;
+    case Method::POST:
+      if (request.body_stream()) {
+        // NOTE: the body gets read via '_Upload' and since we don't
+        // know its size libcurl will use chunked transfer encoding.
+        CHECK_EQ(
+            curl_easy_setopt(easy, CURLOPT_POST, 1),
+            CURLE_OK);
+        break;
+      }
+
+      // Converting PostFields.
+      std::unique_ptr<CURLU, decltype(&curl_url_cleanup)> curl_url_handle(
+          curl_url(),
+          &curl_url_cleanup);
+      CHECK_EQ(
+          curl_url_set(
+              curl_url_handle.get(),
+              CURLUPART_URL,
+              request.uri().c_str(),
+              0),
+          CURLUE_OK);
+      for (const auto& field : request.fields()) {
+        std::string combined = field.first + '=' + field.second;
+        CHECK_EQ(
+            curl_url_set(
+                curl_url_handle.get(),
+                CURLUPART_QUERY,
+                combined.c_str(),
+                CURLU_APPENDQUERY | CURLU_URLENCODE),
+            CURLUE_OK);
+      }
+      char* url_string = nullptr;
+      CHECK_EQ(
+          curl_url_get(
+              curl_url_handle.get(),
+              CURLUPART_QUERY,
+              &url_string,
+              0),
+          CURLUE_OK);
+      fields_string_ = std::unique_ptr<char, decltype(&curl_free)>(
+          url_string,
+          &curl_free);
+      // End of conversion.
+
+      CHECK_EQ(
+          curl_easy_setopt(easy, CURLOPT_HTTPPOST, 1),
+          CURLE_OK);
+      CHECK_EQ(
+          curl_easy_setopt(easy, CURLOPT_POSTFIELDS, fields_string_.get()),
+          CURLE_OK);
+
+      break;
+  }
+
+  // Transform 'Request' headers to curl's linked list.
+  for (const auto& [key, value] : request.headers()) {
+    std::string header = key + ": " + value;
+
+    // We should only be adding the headers once, so they
+    // shouldn't yet exist!
+    CHECK(!curl_headers_)
+        << "not expecting to have already allocated headers";
+
+    curl_slist* list = nullptr;
+
+    // 'curl_slist_append()' copies 'header' so we don't
+    //  have to worry about its lifetime.
+    list = curl_slist_append(list, header.c_str());
+
+    curl_headers_ = std::unique_ptr<
+        curl_slist,
+        decltype(&curl_slist_free_all)>(
+        CHECK_NOTNULL(list),
+        &curl_slist_free_all);
+  }
+
+  CHECK_EQ(
+      curl_easy_setopt(easy, CURLOPT_HTTPHEADER, curl_headers_.get()),
+      CURLE_OK);
+  CHECK_EQ(
+      curl_easy_setopt(easy, CURLOPT_URL, request.uri().c_str()),
+      CURLE_OK);
+  // Option to follow redirects.
+  CHECK_EQ(
+      curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1),
+      CURLE_OK);
+  // The internal mechanism of libcurl to provide timeout support.
+  // Not accurate at very low values.
+  // 0 means that transfer can run indefinitely.
+  CHECK_EQ(
+      curl_easy_setopt(
+          easy,
+          CURLOPT_TIMEOUT_MS,
+          duration_cast<milliseconds>(request.timeout())),
+      CURLE_OK);
+  // If onoff is 1, libcurl will not use any functions that install
+  // signal handlers or any functions that cause signals to be sent
+  // to the process. This option is here to allow multi-threaded
+  // unix applications to still set/use all timeout options etc,
+  // without risking getting signals.
+  // More here: https://curl.se/libcurl/c/CURLOPT_NOSIGNAL.html
+  CHECK_EQ(
+      curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1),
+      CURLE_OK);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+_Upload::_Upload(EventLoop& loop, CURL* easy, Request& request)
+  : loop_(loop),
+    easy_(easy),
+    context_(&loop, "HTTP (upload)"),
+    stream_(
+        std::move(request.body_stream_)
+            .value()
+            .template k<void>(Adaptor{this})) {
+  stream_.Register(interrupt_);
+
+  CHECK_EQ(curl_easy_setopt(easy_, CURLOPT_READDATA, this), CURLE_OK);
+  CHECK_EQ(
+      curl_easy_setopt(easy_, CURLOPT_READFUNCTION, ReadFunction),
+      CURLE_OK);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+_Upload::~_Upload() {
+  CHECK(!started_ || ended_) << "destructing upload before stream ended";
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _Upload::Close(Callback<void()> closed) {
+  CHECK(!closing_);
+
+  closing_ = true;
+
+  // libcurl won't be reading from us anymore.
+  paused_ = false;
+
+  if (!started_ || ended_) {
+    closed();
+    return;
+  }
+
+  closed_ = std::move(closed);
+
+  // NOTE: we only do one of the following because either of them
+  // might cause 'closed_' to get invoked after which we might have
+  // been deallocated.
+  if (requested_) {
+    // The stream will get back to us, at which point we'll tell it
+    // we're done, see 'Begin()' and 'Body()', unless we can get it
+    // to stop sooner.
+    interrupt_.Trigger();
+  } else {
+    CHECK_NOTNULL(upstream_)->Done();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+size_t _Upload::ReadFunction(
+    char* buffer,
+    size_t size,
+    size_t nitems,
+    void* data) {
+  return static_cast<_Upload*>(data)->Read(buffer, size * nitems);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+size_t _Upload::Read(char* buffer, size_t size) {
+  if (offset_ == chunk_.size() && !ended_ && !requested_) {
+    requested_ = true;
+
+    // NOTE: the stream might give us the next chunk (or end) before
+    // returning in which case we don't need to pause.
+    if (!started_) {
+      started_ = true;
+      stream_.Start();
+    } else {
+      CHECK_NOTNULL(upstream_)->Next();
+    }
+  }
+
+  if (offset_ < chunk_.size()) {
+    size = std::min(size, chunk_.size() - offset_);
+    memcpy(buffer, chunk_.data() + offset_, size);
+    offset_ += size;
+    return size;
+  } else if (ended_) {
+    // Returning 0 tells libcurl the body is complete.
+    return error_ ? CURL_READFUNC_ABORT : 0;
+  } else {
+    paused_ = true;
+    return CURL_READFUNC_PAUSE;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _Upload::Begin(TypeErasedStream& stream) {
+  context_.Continue([this, &stream]() {
+    upstream_ = &stream;
+
+    if (closing_) {
+      requested_ = false;
+      upstream_->Done();
+    } else {
+      upstream_->Next();
+    }
+  });
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _Upload::Fail(std::exception_ptr exception) {
+  try {
+    std::rethrow_exception(exception);
+  } catch (const std::exception& e) {
+    error_ = e.what();
+  } catch (...) {
+    error_ = "Body stream failed";
+  }
+
+  context_.Continue([this]() {
+    Finished();
+  });
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _Upload::Stop() {
+  error_ = "Body stream stopped";
+
+  context_.Continue([this]() {
+    Finished();
+  });
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _Upload::Body(std::string&& chunk) {
+  // NOTE: we store the chunk in 'next_' rather than capturing it
+  // because it won't fit in the callback.
+  next_ = std::move(chunk);
+
+  context_.Continue([this]() {
+    requested_ = false;
+
+    if (closing_) {
+      upstream_->Done();
+    } else {
+      chunk_ = std::move(next_);
+      offset_ = 0;
+      Unpause();
+    }
+  });
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _Upload::Ended() {
+  context_.Continue([this]() {
+    Finished();
+  });
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _Upload::Finished() {
+  requested_ = false;
+  ended_ = true;
+
+  if (closing_) {
+    closed_();
+  } else {
+    Unpause();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void _Upload::Unpause() {
+  if (paused_) {
+    paused_ = false;
+
+    // NOTE: libcurl might invoke 'Read()' before this returns.
+    curl_easy_pause(easy_, CURLPAUSE_CONT);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace http
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "eventuals/x509.h"
@@ -10,7 +13,9 @@
 // Must be included after openssl includes.
 #include "curl/curl.h"
 #include "eventuals/event-loop.h"
+#include "eventuals/generator.h"
 #include "eventuals/scheduler.h"
+#include "eventuals/stream.h"
 
 ////////////////////////////////////////////////////////////////////////
 
@@ -33,6 +38,10 @@ using PostFields = std::vector<std::pair<std::string, std::string>>;
 using Header = std::pair<std::string, std::string>;
 using Headers = std::map<std::string, std::string>;
 
+// Type erased stream of the chunks of a request body, see
+// 'Request::Builder().body()'.
+using BodyStream = Generator::Of<std::string>::Raises<std::runtime_error>;
+
 ////////////////////////////////////////////////////////////////////////
 
 class Request final {
@@ -73,10 +82,15 @@ class Request final {
     return certificate_;
   }
 
+  const auto& body_stream() {
+    return body_stream_;
+  }
+
  private:
   friend class Client;
+  friend class _Upload;
 
-  template <bool, bool, bool, bool, bool, bool, bool>
+  template <bool, bool, bool, bool, bool, bool, bool, bool>
   class _Builder;
 
   std::string uri_;
@@ -87,6 +101,7 @@ class Request final {
   PostFields fields_;
   std::optional<bool> verify_peer_;
   std::optional<x509::Certificate> certificate_;
+  std::optional<BodyStream> body_stream_;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -98,7 +113,8 @@ template <
     bool has_fields_,
     bool has_verify_peer_,
     bool has_certificate_,
-    bool has_headers_>
+    bool has_headers_,
+    bool has_body_>
 class Request::_Builder final : public builder::Builder {
  public:
   ~_Builder() override = default;
@@ -112,7 +128,8 @@ class Request::_Builder final : public builder::Builder {
         std::move(fields_),
         std::move(verify_peer_),
         std::move(certificate_),
-        std::move(headers_));
+        std::move(headers_),
+        std::move(body_));
   }
 
   auto method(Method method) && {
@@ -124,7 +141,8 @@ class Request::_Builder final : public builder::Builder {
         std::move(fields_),
         std::move(verify_peer_),
         std::move(certificate_),
-        std::move(headers_));
+        std::move(headers_),
+        std::move(body_));
   }
 
   auto timeout(std::chrono::nanoseconds&& timeout) && {
@@ -136,11 +154,13 @@ class Request::_Builder final : public builder::Builder {
         std::move(fields_),
         std::move(verify_peer_),
         std::move(certificate_),
-        std::move(headers_));
+        std::move(headers_),
+        std::move(body_));
   }
 
   auto fields(PostFields&& fields) && {
     static_assert(!has_fields_, "Duplicate 'fields'");
+    static_assert(!has_body_, "Can't have both 'fields' and 'body'");
     return Construct<_Builder>(
         std::move(uri_),
         std::move(method_),
@@ -148,7 +168,8 @@ class Request::_Builder final : public builder::Builder {
         fields_.Set(std::move(fields)),
         std::move(verify_peer_),
         std::move(certificate_),
-        std::move(headers_));
+        std::move(headers_),
+        std::move(body_));
   }
 
   auto verify_peer(bool verify_peer) && {
@@ -161,7 +182,8 @@ class Request::_Builder final : public builder::Builder {
         std::move(fields_),
         verify_peer_.Set(std::move(verify_peer)),
         std::move(certificate_),
-        std::move(headers_));
+        std::move(headers_),
+        std::move(body_));
   }
 
   // Specify the certificate to use when doing verification. Same
@@ -180,7 +202,8 @@ class Request::_Builder final : public builder::Builder {
         std::move(fields_),
         std::move(verify_peer_),
         certificate_.Set(std::move(certificate)),
-        std::move(headers_));
+        std::move(headers_),
+        std::move(body_));
   }
 
   auto header(std::string&& key, std::string&& value) && {
@@ -210,7 +233,32 @@ class Request::_Builder final : public builder::Builder {
         std::move(fields_),
         std::move(verify_peer_),
         std::move(certificate_),
-        headers_.Set(std::move(headers_).value()));
+        headers_.Set(std::move(headers_).value()),
+        std::move(body_));
+  }
+
+  // Streams the body of the request from 'stream', which can be any
+  // stream of 'std::string' (e.g., the chunks of a file read with
+  // 'ReadFile()'), using chunked transfer encoding so the body never
+  // has to be entirely in memory. Requires the 'POST' method.
+  template <typename S>
+  auto body(S stream) && {
+    static_assert(!has_body_, "Duplicate 'body'");
+    static_assert(!has_fields_, "Can't have both 'fields' and 'body'");
+    return Construct<_Builder>(
+        std::move(uri_),
+        std::move(method_),
+        std::move(timeout_),
+        std::move(fields_),
+        std::move(verify_peer_),
+        std::move(certificate_),
+        std::move(headers_),
+        body_.Set(BodyStream(
+            // NOTE: 'Generator' requires a callable that fits in a
+            // 'Callback' so we keep the stream on the heap.
+            [stream = std::make_unique<S>(std::move(stream))]() mutable {
+              return std::move(*stream);
+            })));
   }
 
   Request Build() && {
@@ -239,6 +287,11 @@ class Request::_Builder final : public builder::Builder {
 
     request.headers_ = std::move(headers_).value();
 
+    if constexpr (has_body_) {
+      CHECK_EQ(request.method_, POST) << "'body' requires method 'POST'";
+      request.body_stream_.emplace(std::move(body_).value());
+    }
+
     return request;
   }
 
@@ -255,14 +308,16 @@ class Request::_Builder final : public builder::Builder {
       builder::Field<PostFields, has_fields_> fields,
       builder::Field<bool, has_verify_peer_> verify_peer,
       builder::Field<x509::Certificate, has_certificate_> certificate,
-      builder::RepeatedField<Headers, has_headers_> headers)
+      builder::RepeatedField<Headers, has_headers_> headers,
+      builder::Field<BodyStream, has_body_> body)
     : uri_(std::move(uri)),
       method_(std::move(method)),
       timeout_(std::move(timeout)),
       fields_(std::move(fields)),
       verify_peer_(std::move(verify_peer)),
       certificate_(std::move(certificate)),
-      headers_(std::move(headers)) {}
+      headers_(std::move(headers)),
+      body_(std::move(body)) {}
 
   builder::Field<std::string, has_uri_> uri_;
   builder::Field<Method, has_method_> method_;
@@ -271,16 +326,142 @@ class Request::_Builder final : public builder::Builder {
   builder::Field<bool, has_verify_peer_> verify_peer_;
   builder::Field<x509::Certificate, has_certificate_> certificate_;
   builder::RepeatedField<Headers, has_headers_> headers_ = Headers{};
+  builder::Field<BodyStream, has_body_> body_;
 };
 
 ////////////////////////////////////////////////////////////////////////
 
 inline auto Request::Builder() {
-  return Request::_Builder<false, false, false, false, false, false, false>();
+  return Request::_Builder<
+      false,
+      false,
+      false,
+      false,
+      false,
+      false,
+      false,
+      false>();
 }
 
 ////////////////////////////////////////////////////////////////////////
 
+// Table of response headers built by a single pass over the raw
+// header bytes received from libcurl. Keys and values are views into
+// those bytes (kept alive by the table) except for a header that was
+// received more than once, whose values get combined (see RFC 7230,
+// section 3.2.2) into a separate buffer. Lookups are hashed and case
+// insensitive, as are header names.
+//
+// NOTE: we store offsets rather than 'std::string_view' so that the
+// table can be copied and moved without having to fix up the views.
+class HeaderTable final {
+ private:
+  struct Entry {
+    uint32_t key_offset;
+    uint32_t key_size;
+    uint32_t value_offset;
+    uint32_t value_size;
+
+    // Whether or not the value is in 'combined_' versus 'raw_'.
+    bool combined;
+  };
+
+ public:
+  using value_type = std::pair<std::string_view, std::string_view>;
+
+  class const_iterator final {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = HeaderTable::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    value_type operator*() const {
+      return table_->Get(*entry_);
+    }
+
+    const_iterator& operator++() {
+      ++entry_;
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator previous = *this;
+      ++entry_;
+      return previous;
+    }
+
+    bool operator==(const const_iterator& that) const {
+      return entry_ == that.entry_;
+    }
+
+    bool operator!=(const const_iterator& that) const {
+      return entry_ != that.entry_;
+    }
+
+   private:
+    friend class HeaderTable;
+
+    const_iterator(
+        const HeaderTable* table,
+        std::vector<Entry>::const_iterator entry)
+      : table_(table),
+        entry_(entry) {}
+
+    const HeaderTable* table_;
+    std::vector<Entry>::const_iterator entry_;
+  };
+
+  HeaderTable() = default;
+
+  // Parses 'raw' which is expected to be lines (separated by "\r\n"
+  // or "\n") of the form "Key: Value", ignoring any other lines such
+  // as "HTTP/1.1 200 OK".
+  explicit HeaderTable(std::string&& raw);
+
+  // Returns the value of the header named 'key' (case insensitive).
+  std::optional<std::string_view> Find(std::string_view key) const;
+
+  const_iterator begin() const {
+    return const_iterator(this, entries_.begin());
+  }
+
+  const_iterator end() const {
+    return const_iterator(this, entries_.end());
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  bool empty() const {
+    return entries_.empty();
+  }
+
+ private:
+  value_type Get(const Entry& entry) const;
+
+  // Returns the index of the slot for 'key', either empty or holding
+  // the entry for 'key'.
+  size_t Probe(std::string_view key) const;
+
+  // Raw header bytes that (most) keys and values point into.
+  std::string raw_;
+
+  // Values of headers that were received more than once.
+  std::string combined_;
+
+  // Entries in the order they were received.
+  std::vector<Entry> entries_;
+
+  // Open addressing hash table of indexes into 'entries_' plus one,
+  // i.e., 0 means the slot is empty. Always a power of two in size.
+  std::vector<uint32_t> slots_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
 struct Response final {
   Response() = default;
 
@@ -294,8 +475,24 @@ struct Response final {
     return code_;
   }
 
-  const auto& headers() const {
-    return headers_;
+  // Returns the headers as a map, copying them out of the
+  // 'header_table()' the first time this gets called.
+  //
+  // NOTE: prefer 'header_table()' which doesn't allocate.
+  const Headers& headers() const {
+    if (!headers_) {
+      headers_.emplace();
+      for (const auto& [key, value] : header_table_) {
+        headers_->emplace(key, value);
+      }
+    }
+    return headers_.value();
+  }
+
+  // Returns the headers as views into the raw bytes received, see
+  // 'HeaderTable'.
+  const HeaderTable& header_table() const {
+    return header_table_;
   }
 
   const auto& body() const {
@@ -307,19 +504,245 @@ struct Response final {
 
   Response(
       long code,
-      Headers&& headers,
+      HeaderTable&& header_table,
       std::string&& body)
     : code_(code),
-      headers_(std::move(headers)),
+      header_table_(std::move(header_table)),
       body_(std::move(body)) {}
 
   long code_;
-  Headers headers_;
+  HeaderTable header_table_;
+
+  // Lazily built by 'headers()'.
+  mutable std::optional<Headers> headers_;
+
   std::string body_;
 };
 
 ////////////////////////////////////////////////////////////////////////
 
+// Shared by a 'Client' (and all of its copies) and each of its
+// outstanding transfers: a curl multi handle driven by the event
+// loop, a curl share handle so that DNS and TLS session caches are
+// shared between transfers, and a pool of idle easy handles. Because
+// the multi handle outlives each transfer its connections are kept
+// alive and reused by subsequent transfers to the same host.
+//
+// NOTE: except for construction and destruction everything must be
+// done from within the event loop of the first transfer.
+class _ConnectionPool final
+  : public std::enable_shared_from_this<_ConnectionPool> {
+ public:
+  // Default maximum number of idle connections (and easy handles)
+  // that are kept around for reuse.
+  static constexpr size_t DEFAULT_SIZE = 16;
+
+  // Default maximum number of concurrent HTTP/2 streams per
+  // connection, same as libcurl's default.
+  static constexpr size_t DEFAULT_MAX_CONCURRENT_STREAMS = 100;
+
+  _ConnectionPool(
+      size_t size = DEFAULT_SIZE,
+      std::optional<std::chrono::nanoseconds> idle_timeout = std::nullopt,
+      bool http2 = false,
+      size_t max_concurrent_streams = DEFAULT_MAX_CONCURRENT_STREAMS);
+
+  _ConnectionPool(const _ConnectionPool&) = delete;
+
+  ~_ConnectionPool();
+
+  // Returns an easy handle, reusing an idle one if possible.
+  CURL* Acquire(EventLoop& loop);
+
+  // Returns the easy handle to the pool so it can be reused.
+  void Release(CURL* easy);
+
+  // Starts the transfer for 'easy' which must have been acquired from
+  // this pool. Once the transfer has completed 'done' gets invoked
+  // with the result unless the transfer was aborted via 'Remove()'.
+  void Add(CURL* easy, Callback<void(CURLcode)>* done);
+
+  // Aborts the transfer for 'easy'.
+  void Remove(CURL* easy);
+
+ private:
+  // https://curl.se/libcurl/c/CURLMOPT_SOCKETFUNCTION.html
+  static int SocketFunction(
+      CURL* easy,
+      curl_socket_t socket,
+      int what,
+      void* data,
+      void* poll);
+
+  // https://curl.se/libcurl/c/CURLMOPT_TIMERFUNCTION.html
+  static int TimerFunction(CURLM* multi, long timeout_ms, void* data);
+
+  // Invokes 'done' for each transfer that has completed.
+  void Check();
+
+  // Closes the timer and polls if there aren't any transfers so that
+  // an idle pool doesn't hold on to any event loop handles (and can
+  // thus be destructed from any thread).
+  void Idle();
+
+  const size_t size_;
+  const std::optional<std::chrono::nanoseconds> idle_timeout_;
+  const bool http2_;
+
+  EventLoop* loop_ = nullptr;
+
+  CURLM* multi_;
+  CURLSH* share_;
+
+  // Idle easy handles.
+  std::vector<CURL*> easies_;
+
+  // Number of transfers that have been added but not yet completed
+  // or removed.
+  size_t transfers_ = 0;
+
+  uv_timer_t* timer_ = nullptr;
+  std::vector<uv_poll_t*> polls_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Sets the options on an easy handle for a 'Request', i.e., everything
+// except for the write and header functions which depend on how the
+// response gets consumed, and owns any memory that libcurl expects to
+// stay valid for the duration of the transfer.
+class _Options final {
+ public:
+  _Options()
+    : fields_string_(nullptr, &curl_free),
+      curl_headers_(nullptr, &curl_slist_free_all) {}
+
+  // Returns false if the certificate of the request (if any) could
+  // not be PEM encoded.
+  bool Set(CURL* easy, Request& request);
+
+ private:
+  // Stores converted PostFields as a C string.
+  std::unique_ptr<char, decltype(&curl_free)> fields_string_;
+
+  std::unique_ptr<curl_slist, decltype(&curl_slist_free_all)> curl_headers_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Feeds libcurl the body of a request from its 'BodyStream' via
+// 'CURLOPT_READFUNCTION', asking the stream for the next chunk only
+// once libcurl has read the previous one and pausing the transfer
+// with 'CURL_READFUNC_PAUSE' while the stream doesn't have a chunk
+// ready yet.
+//
+// NOTE: except for the stream continuing us (which might happen on
+// another thread and gets submitted to the event loop) everything
+// must be done from within the event loop.
+class _Upload final {
+ public:
+  _Upload(EventLoop& loop, CURL* easy, Request& request);
+
+  _Upload(const _Upload&) = delete;
+
+  ~_Upload();
+
+  // Invokes 'closed' once the stream has ended, telling the stream
+  // we're done (and interrupting it) if it hasn't ended yet, after
+  // which libcurl must not read from us anymore (i.e., the transfer
+  // has completed or been removed).
+  void Close(Callback<void()> closed);
+
+  // Returns the error of the stream, if it failed or was stopped.
+  const auto& error() {
+    return error_;
+  }
+
+ private:
+  struct Adaptor final {
+    void Begin(TypeErasedStream& stream) {
+      upload_->Begin(stream);
+    }
+
+    template <typename Error>
+    void Fail(Error&& error) {
+      upload_->Fail(
+          make_exception_ptr_or_forward(
+              std::forward<Error>(error)));
+    }
+
+    void Stop() {
+      upload_->Stop();
+    }
+
+    void Body(std::string&& chunk) {
+      upload_->Body(std::move(chunk));
+    }
+
+    void Ended() {
+      upload_->Ended();
+    }
+
+    void Register(Interrupt&) {}
+
+    _Upload* upload_;
+  };
+
+  // https://curl.se/libcurl/c/CURLOPT_READFUNCTION.html
+  static size_t ReadFunction(
+      char* buffer,
+      size_t size,
+      size_t nitems,
+      void* data);
+
+  size_t Read(char* buffer, size_t size);
+
+  void Begin(TypeErasedStream& stream);
+  void Fail(std::exception_ptr exception);
+  void Stop();
+  void Body(std::string&& chunk);
+  void Ended();
+
+  // Invoked once the stream has ended, failed, or stopped.
+  void Finished();
+
+  // Resumes the transfer if it was paused waiting for the stream.
+  void Unpause();
+
+  EventLoop& loop_;
+  CURL* easy_;
+
+  Scheduler::Context context_;
+
+  Interrupt interrupt_;
+
+  decltype(std::declval<BodyStream>().template k<void>(
+      std::declval<Adaptor>())) stream_;
+
+  // Set once the stream has begun.
+  TypeErasedStream* upstream_ = nullptr;
+
+  // Chunk that libcurl is currently reading from and how much of it
+  // has already been read.
+  std::string chunk_;
+  size_t offset_ = 0;
+
+  // Next chunk from the stream, only accessed while 'requested_'.
+  std::string next_;
+
+  bool started_ = false;
+  bool requested_ = false;
+  bool paused_ = false;
+  bool ended_ = false;
+  bool closing_ = false;
+
+  std::optional<std::string> error_;
+
+  Callback<void()> closed_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
 class Client final {
  public:
   // Constructs a new http::Client "builder" with the default
@@ -339,17 +762,49 @@ class Client final {
 
   auto Do(Request&& request);
 
+  // Like 'Do()' except returns a stream of the chunks of the body as
+  // they are received rather than buffering the entire response.
+  //
+  // NOTE: since there is no 'Response' to get the status code from
+  // the stream fails (without propagating any of the body) if the
+  // status code is 400 or greater.
+  auto Stream(Request&& request);
+
  private:
-  template <bool, bool>
+  template <bool, bool, bool, bool, bool, bool, bool>
   class _Builder;
 
+  // Returns the event loop to use for requests.
+  EventLoop& loop() {
+    return loop_ != nullptr ? *loop_ : EventLoop::Default();
+  }
+
+  // Sets the options of this client on 'request' that weren't set
+  // explicitly for the request.
+  void Inherit(Request& request);
+
   std::optional<bool> verify_peer_;
   std::optional<x509::Certificate> certificate_;
+
+  // Event loop to use for requests or nullptr for the default loop.
+  EventLoop* loop_ = nullptr;
+
+  // NOTE: shared with any copies of this client as well as any
+  // outstanding transfers since they might outlive this client.
+  std::shared_ptr<_ConnectionPool> pool_ =
+      std::make_shared<_ConnectionPool>();
 };
 
 ////////////////////////////////////////////////////////////////////////
 
-template <bool has_verify_peer_, bool has_certificate_>
+template <
+    bool has_verify_peer_,
+    bool has_certificate_,
+    bool has_pool_size_,
+    bool has_idle_timeout_,
+    bool has_http2_,
+    bool has_max_concurrent_streams_,
+    bool has_loop_>
 class Client::_Builder final : public builder::Builder {
  public:
   ~_Builder() override = default;
@@ -359,7 +814,12 @@ class Client::_Builder final : public builder::Builder {
     // TODO(benh): consider checking that the scheme is 'https'.
     return Construct<_Builder>(
         verify_peer_.Set(std::move(verify_peer)),
-        std::move(certificate_));
+        std::move(certificate_),
+        std::move(pool_size_),
+        std::move(idle_timeout_),
+        std::move(http2_),
+        std::move(max_concurrent_streams_),
+        std::move(loop_));
   }
 
   // Specify the certificate to use when doing verification. Same
@@ -373,7 +833,92 @@ class Client::_Builder final : public builder::Builder {
     // TODO(benh): consider checking that the scheme is 'https'.
     return Construct<_Builder>(
         std::move(verify_peer_),
-        certificate_.Set(std::move(certificate)));
+        certificate_.Set(std::move(certificate)),
+        std::move(pool_size_),
+        std::move(idle_timeout_),
+        std::move(http2_),
+        std::move(max_concurrent_streams_),
+        std::move(loop_));
+  }
+
+  // Maximum number of idle connections to keep alive for reuse by
+  // subsequent requests, defaults to '_ConnectionPool::DEFAULT_SIZE'.
+  auto pool_size(size_t pool_size) && {
+    static_assert(!has_pool_size_, "Duplicate 'pool_size'");
+    return Construct<_Builder>(
+        std::move(verify_peer_),
+        std::move(certificate_),
+        pool_size_.Set(std::move(pool_size)),
+        std::move(idle_timeout_),
+        std::move(http2_),
+        std::move(max_concurrent_streams_),
+        std::move(loop_));
+  }
+
+  // How long a connection may be idle and still get reused, rounded
+  // down to seconds. Same semantics as 'CURLOPT_MAXAGE_CONN', i.e.,
+  // defaults to 118 seconds.
+  auto idle_timeout(std::chrono::nanoseconds&& idle_timeout) && {
+    static_assert(!has_idle_timeout_, "Duplicate 'idle_timeout'");
+    return Construct<_Builder>(
+        std::move(verify_peer_),
+        std::move(certificate_),
+        std::move(pool_size_),
+        idle_timeout_.Set(std::move(idle_timeout)),
+        std::move(http2_),
+        std::move(max_concurrent_streams_),
+        std::move(loop_));
+  }
+
+  // Whether or not to use HTTP/2 (negotiated via ALPN for 'https'
+  // and otherwise falling back to HTTP/1.1), multiplexing concurrent
+  // requests to the same host as separate streams on a single
+  // connection rather than opening a connection per request.
+  auto http2(bool http2) && {
+    static_assert(!has_http2_, "Duplicate 'http2'");
+    return Construct<_Builder>(
+        std::move(verify_peer_),
+        std::move(certificate_),
+        std::move(pool_size_),
+        std::move(idle_timeout_),
+        http2_.Set(std::move(http2)),
+        std::move(max_concurrent_streams_),
+        std::move(loop_));
+  }
+
+  // Maximum number of concurrent HTTP/2 streams per connection,
+  // defaults to '_ConnectionPool::DEFAULT_MAX_CONCURRENT_STREAMS'.
+  // Requests beyond this open another connection. Same semantics as
+  // 'CURLMOPT_MAX_CONCURRENT_STREAMS'.
+  auto max_concurrent_streams(size_t max_concurrent_streams) && {
+    static_assert(
+        !has_max_concurrent_streams_,
+        "Duplicate 'max_concurrent_streams'");
+    return Construct<_Builder>(
+        std::move(verify_peer_),
+        std::move(certificate_),
+        std::move(pool_size_),
+        std::move(idle_timeout_),
+        std::move(http2_),
+        max_concurrent_streams_.Set(std::move(max_concurrent_streams)),
+        std::move(loop_));
+  }
+
+  // Event loop to use for requests, defaults to
+  // 'EventLoop::Default()'. A client (and all of its copies) only
+  // ever uses one loop since its connections are driven by that
+  // loop, so to spread requests across an 'EventLoopGroup' build a
+  // client for each loop, e.g., 'loop(EventLoop::ForCPU(cpu))'.
+  auto loop(EventLoop& loop) && {
+    static_assert(!has_loop_, "Duplicate 'loop'");
+    return Construct<_Builder>(
+        std::move(verify_peer_),
+        std::move(certificate_),
+        std::move(pool_size_),
+        std::move(idle_timeout_),
+        std::move(http2_),
+        std::move(max_concurrent_streams_),
+        loop_.Set(&loop));
   }
 
   Client Build() && {
@@ -387,6 +932,43 @@ class Client::_Builder final : public builder::Builder {
       client.certificate_ = std::move(certificate_).value();
     }
 
+    if constexpr (has_loop_) {
+      client.loop_ = std::move(loop_).value();
+    }
+
+    static_assert(
+        !has_max_concurrent_streams_ || has_http2_,
+        "'max_concurrent_streams' requires 'http2'");
+
+    if constexpr (has_pool_size_ || has_idle_timeout_ || has_http2_) {
+      size_t pool_size = _ConnectionPool::DEFAULT_SIZE;
+      if constexpr (has_pool_size_) {
+        pool_size = std::move(pool_size_).value();
+      }
+
+      std::optional<std::chrono::nanoseconds> idle_timeout;
+      if constexpr (has_idle_timeout_) {
+        idle_timeout = std::move(idle_timeout_).value();
+      }
+
+      bool http2 = false;
+      if constexpr (has_http2_) {
+        http2 = std::move(http2_).value();
+      }
+
+      size_t max_concurrent_streams =
+          _ConnectionPool::DEFAULT_MAX_CONCURRENT_STREAMS;
+      if constexpr (has_max_concurrent_streams_) {
+        max_concurrent_streams = std::move(max_concurrent_streams_).value();
+      }
+
+      client.pool_ = std::make_shared<_ConnectionPool>(
+          pool_size,
+          idle_timeout,
+          http2,
+          max_concurrent_streams);
+    }
+
     return client;
   }
 
@@ -398,18 +980,35 @@ class Client::_Builder final : public builder::Builder {
 
   _Builder(
       builder::Field<bool, has_verify_peer_> verify_peer,
-      builder::Field<x509::Certificate, has_certificate_> certificate)
+      builder::Field<x509::Certificate, has_certificate_> certificate,
+      builder::Field<size_t, has_pool_size_> pool_size,
+      builder::Field<std::chrono::nanoseconds, has_idle_timeout_>
+          idle_timeout,
+      builder::Field<bool, has_http2_> http2,
+      builder::Field<size_t, has_max_concurrent_streams_>
+          max_concurrent_streams,
+      builder::Field<EventLoop*, has_loop_> loop)
     : verify_peer_(std::move(verify_peer)),
-      certificate_(std::move(certificate)) {}
+      certificate_(std::move(certificate)),
+      pool_size_(std::move(pool_size)),
+      idle_timeout_(std::move(idle_timeout)),
+      http2_(std::move(http2)),
+      max_concurrent_streams_(std::move(max_concurrent_streams)),
+      loop_(std::move(loop)) {}
 
   builder::Field<bool, has_verify_peer_> verify_peer_;
   builder::Field<x509::Certificate, has_certificate_> certificate_;
+  builder::Field<size_t, has_pool_size_> pool_size_;
+  builder::Field<std::chrono::nanoseconds, has_idle_timeout_> idle_timeout_;
+  builder::Field<bool, has_http2_> http2_;
+  builder::Field<size_t, has_max_concurrent_streams_> max_concurrent_streams_;
+  builder::Field<EventLoop*, has_loop_> loop_;
 };
 
 ////////////////////////////////////////////////////////////////////////
 
 inline auto Client::Builder() {
-  return Client::_Builder<false, false>();
+  return Client::_Builder<false, false, false, false, false, false, false>();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -417,31 +1016,26 @@ inline auto Client::Builder() {
 // Our own eventual for using libcurl with the EventLoop.
 //
 // The general algorithm:
-// 1. Create easy and multi handles. Set options for them.
-//    Add easy handle to multi handle with curl_multi_add_handle.
-//    TIMERFUNCTION is called to set a timer which will tell us when
-//    to perform checks on libcurl handles.
-//    SOCKETFUNCTION is called by using curl_multi_socket_action.
-//    We can pass specific socket descriptor to work with that particular
-//    socket or we can pass CURL_SOCKET_TIMEOUT to let libcurl call a function
-//    for each socket that is currently in use.
-// 2. Whenever SOCKETFUNCTION is called we check for events and set a poll
-//    handle for the particular socket. This poll handle is created on heap
-//    and that's why we put its pointer inside vector so that we can stop it
-//    when we have to interrupt the transfer.
-// 3. Whenever curl_multi_socket_action is called we can get an amount of
-//    remaining running easy handles. If this value is 0 then we read info
-//    from multi handle using check_multi_info lambda and clean everything up.
+// 1. Acquire an easy handle from the client's '_ConnectionPool' and
+//    set the options for the request.
+// 2. Add the easy handle to the pool's multi handle which drives the
+//    transfer using the event loop (see '_ConnectionPool' for how
+//    the sockets and timers of libcurl are mapped onto the loop).
+// 3. Once the transfer has completed the pool calls us back with the
+//    result at which point we release the easy handle back to the
+//    pool (keeping the connection alive for another request) and
+//    build the 'Response'.
 struct _HTTP final {
   template <typename K_>
   struct Continuation final {
-    Continuation(K_ k, EventLoop& loop, Request&& request)
+    Continuation(
+        K_ k,
+        EventLoop& loop,
+        Request&& request,
+        std::shared_ptr<_ConnectionPool> pool)
       : loop_(loop),
         request_(std::move(request)),
-        fields_string_(nullptr, &curl_free),
-        easy_(curl_easy_init(), &curl_easy_cleanup),
-        multi_(curl_multi_init(), &curl_multi_cleanup),
-        curl_headers_(nullptr, &curl_slist_free_all),
+        pool_(std::move(pool)),
         context_(&loop, "HTTP (start/fail/stop)"),
         interrupt_context_(&loop_, "HTTP (interrupt)"),
         k_(std::move(k)) {}
@@ -449,10 +1043,8 @@ struct _HTTP final {
     Continuation(Continuation&& that)
       : loop_(that.loop_),
         request_(std::move(that.request_)),
-        fields_string_(std::move(that.fields_string_)),
-        easy_(std::move(that.easy_)),
-        multi_(std::move(that.multi_)),
-        curl_headers_(std::move(that.curl_headers_)),
+        pool_(std::move(that.pool_)),
+        options_(std::move(that.options_)),
         context_(&that.loop_, "HTTP (start/fail/stop)"),
         interrupt_context_(&that.loop_, "HTTP (interrupt)"),
         k_(std::move(that.k_)) {
@@ -472,385 +1064,24 @@ struct _HTTP final {
             if (!completed_) {
               started_ = true;
 
-              CHECK(!error_);
-
-              CHECK_NOTNULL(easy_);
-              CHECK_NOTNULL(multi_);
-
-              // If applicable, PEM encode any certificate now before we start
-              // anything and can easily propagate an error.
-              auto certificate = request_.certificate();
-              if (certificate) {
-                auto pem_certificate = pem::Encode(
-                    x509::Certificate(*certificate));
+              easy_ = CHECK_NOTNULL(pool_->Acquire(loop_));
 
-                if (!pem_certificate) {
-                  completed_ = true;
+              if (!options_.Set(easy_, request_)) {
+                completed_ = true;
+                closed_ = true;
 
-                  k_.Fail(std::runtime_error(
-                      "Failed to PEM encode certificate"));
+                pool_->Release(easy_);
+                easy_ = nullptr;
 
-                  curl_easy_cleanup(easy_.get());
-                  curl_multi_cleanup(multi_.get());
+                k_.Fail(std::runtime_error(
+                    "Failed to PEM encode certificate"));
 
-                  return; // Don't do anything else!
-                } else {
-                  curl_blob blob;
-                  blob.data = pem_certificate->data();
-                  blob.len = pem_certificate->size();
-                  blob.flags = CURL_BLOB_COPY;
-                  CHECK_EQ(
-                      curl_easy_setopt(
-                          easy_.get(),
-                          CURLOPT_CAINFO_BLOB,
-                          &blob),
-                      CURLE_OK);
-                }
+                return; // Don't do anything else!
               }
 
-              CHECK_EQ(0, uv_timer_init(loop_, &timer_));
-              uv_handle_set_data((uv_handle_t*) &timer_, this);
-
-              // Called only one time to finish the transfer
-              // and clean everything up.
-              static auto check_multi_info = [](Continuation& continuation) {
-                continuation.completed_ = true;
-
-                // Stores the amount of remaining messages in multi handle.
-                // Unused.
-                int msgq = 0;
-                CURLMsg* message = curl_multi_info_read(
-                    continuation.multi_.get(),
-                    &msgq);
-
-                // Getting the response code and body.
-                switch (message->msg) {
-                  case CURLMSG_DONE:
-                    if (message->data.result == CURLE_OK) {
-                      curl_easy_getinfo(
-                          continuation.easy_.get(),
-                          CURLINFO_RESPONSE_CODE,
-                          &continuation.code_);
-                    } else {
-                      continuation.error_ = message->data.result;
-                    }
-                    break;
-                  default:
-                    continuation.error_ = CURLE_ABORTED_BY_CALLBACK;
-                    break;
-                }
-
-                // Stop transfer completely.
-                CHECK_EQ(
-                    curl_multi_remove_handle(
-                        continuation.multi_.get(),
-                        message->easy_handle),
-                    CURLM_OK);
-
-                // Memory cleanup.
-                for (auto& poll : continuation.polls_) {
-                  if (uv_is_active((uv_handle_t*) poll)) {
-                    uv_poll_stop(poll);
-                  }
-                  uv_close(
-                      (uv_handle_t*) poll,
-                      [](uv_handle_t* handle) {
-                        delete handle;
-                      });
-                }
-
-                continuation.polls_.clear();
-
-                // We don't have to check uv_is_active for timer since
-                // libuv checks it by itself.
-                // Return value is always 0.
-                uv_timer_stop(&continuation.timer_);
-                uv_close(
-                    (uv_handle_t*) &continuation.timer_,
-                    [](uv_handle_t* handle) {
-                      auto& continuation = *(Continuation*) handle->data;
-                      continuation.closed_ = true;
-
-                      if (!continuation.error_) {
-                        // Build headers map.
-                        std::stringstream headers_buffer_stringstream(
-                            continuation.headers_buffer_.Extract());
-                        std::map<std::string, std::string> headers;
-
-                        // Typical 'headers_buffer_stringstream'
-                        // looks like this:
-                        // --------------------------------
-                        // HTTP/1.1 200
-                        // SomeHeaderKey1: SomeHeaderValue1
-                        // SomeHeaderKey2: SomeHeaderValue2
-                        // --------------------------------
-                        while (!headers_buffer_stringstream.eof()) {
-                          std::string line;
-                          std::getline(headers_buffer_stringstream, line);
-
-                          // Find where ':' is.
-                          auto column_iterator = std::find(
-                              line.cbegin(),
-                              line.cend(),
-                              ':');
-
-                          // Skip lines like 'HTTP/1.1 200' that aren't headers.
-                          if (column_iterator == line.cend()) {
-                            continue;
-                          }
-
-                          // Assign key and value.
-                          auto key = std::string(
-                              line.cbegin(),
-                              column_iterator);
-                          auto value = std::string(
-                              column_iterator + 1,
-                              line.cend());
-
-                          // Helper lambda for removing leading
-                          // and trailing spaces.
-                          // TODO: use absl.
-                          static auto trim = [](std::string&& string) {
-                            auto start_iterator = string.begin();
-                            while (start_iterator != string.end()
-                                   && std::isspace(*start_iterator)) {
-                              start_iterator++;
-                            }
-
-                            auto end_iterator = string.end();
-                            do {
-                              end_iterator--;
-                            } while (std::distance(
-                                         start_iterator,
-                                         end_iterator)
-                                         > 0
-                                     && std::isspace(*end_iterator));
-
-                            return std::string(
-                                start_iterator,
-                                end_iterator + 1);
-                          };
-
-                          // Remove leading and trailing spaces.
-                          key = trim(std::move(key));
-                          value = trim(std::move(value));
-
-                          // Add key and value to the map.
-                          // RFC 7230, section 3.2.2:
-                          // A recipient MAY combine multiple header fields
-                          // with the same field name into one
-                          // "field-name: field-value" pair, without changing
-                          // the semantics of the message, by appending each
-                          // subsequent field value to the combined field
-                          // value in order, separated by a comma. The order
-                          // in which header fields with the same field name
-                          // are received is therefore significant to the
-                          // interpretation of the combined field value;
-                          // a proxy MUST NOT change the order of these field
-                          // values when forwarding a message.
-                          //
-                          // NOTE: If user tries to add an already
-                          // existing header, append the new one
-                          // to the old one using comma.
-                          // Example:
-                          // Cookie: cookie1=value1, cookie2=value2
-                          auto iterator = headers.find(key);
-                          if (iterator == headers.end()) {
-                            // Header doesn't exist yet.
-                            headers.emplace(std::move(key), std::move(value));
-                          } else {
-                            // Header already exists.
-                            headers[key] += ", ";
-                            headers[key] += std::move(value);
-                          }
-                        }
-
-                        continuation.k_.Start(Response{
-                            continuation.code_,
-                            std::move(headers),
-                            continuation.body_buffer_.Extract()});
-                      } else {
-                        continuation.k_.Fail(
-                            std::runtime_error(
-                                curl_easy_strerror(
-                                    (CURLcode) continuation.error_)));
-                      }
-                    });
-              };
-
-              static auto poll_callback = [](uv_poll_t* handle,
-                                             int status,
-                                             int events) {
-                auto& continuation = *(Continuation*) handle->data;
-
-                int flags = 0;
-                if (status < 0) {
-                  flags = CURL_CSELECT_ERR;
-                }
-                if (status == 0 && (events & UV_READABLE)) {
-                  flags |= CURL_CSELECT_IN;
-                }
-                if (status == 0 && (events & UV_WRITABLE)) {
-                  flags |= CURL_CSELECT_OUT;
-                }
-
-                // Getting underlying socket desriptor from poll handle.
-                uv_os_fd_t socket_descriptor;
-                uv_fileno(
-                    (uv_handle_t*) handle,
-                    &socket_descriptor);
-
-                // Stores the amount of running easy handles.
-                // Set by curl_multi_socket_action.
-                int running_handles = 0;
-
-                // Perform an action for the particular socket
-                // which is the one we are currently working with.
-                // We don't want to perform an action on every socket inside
-                // libcurl - only that one.
-                curl_multi_socket_action(
-                    continuation.multi_.get(),
-                    (curl_socket_t) socket_descriptor,
-                    flags,
-                    &running_handles);
-
-                // If 0 - finalize the transfer.
-                if (running_handles == 0) {
-                  check_multi_info(continuation);
-                }
-              };
-
-              static auto timer_callback = [](uv_timer_t* handle) {
-                auto& continuation = *(Continuation*) handle->data;
-
-                // Stores the amount of running easy handles.
-                // Set by curl_multi_socket_action.
-                int running_handles = 0;
-
-                // Called with CURL_SOCKET_TIMEOUT to
-                // perform an action with each and every socket
-                // currently in use by libcurl.
-                curl_multi_socket_action(
-                    continuation.multi_.get(),
-                    CURL_SOCKET_TIMEOUT,
-                    0,
-                    &running_handles);
-
-                // If 0 - finalize the transfer.
-                if (running_handles == 0) {
-                  check_multi_info(continuation);
-                }
-              };
-
-              static auto socket_function = +[](CURL* easy,
-                                                curl_socket_t sockfd,
-                                                int what,
-                                                Continuation* continuation,
-                                                void* socket_poller) {
-                int events = 0;
-
-                switch (what) {
-                  case CURL_POLL_IN:
-                  case CURL_POLL_OUT:
-                  case CURL_POLL_INOUT:
-                    // Add poll handle for this particular socket.
-                    if (what & CURL_POLL_IN) {
-                      events |= UV_READABLE;
-                    }
-                    if (what & CURL_POLL_OUT) {
-                      events |= UV_WRITABLE;
-                    }
-
-                    // If no poll handle is assigned to this socket.
-                    if (socket_poller == nullptr) {
-                      socket_poller = new uv_poll_t();
-                      continuation->polls_.push_back(
-                          (uv_poll_t*) socket_poller);
-
-                      CHECK_EQ(
-                          uv_poll_init_socket(
-                              continuation->loop_,
-                              (uv_poll_t*) socket_poller,
-                              sockfd),
-                          0);
-
-                      uv_handle_set_data(
-                          (uv_handle_t*) socket_poller,
-                          continuation);
-
-                      // Assign created poll handle so that in the future
-                      // we can get it through socket_poller argument.
-                      // Useful to check if we already have a poll handle
-                      // for the socket currently in use.
-                      CHECK_EQ(
-                          curl_multi_assign(
-                              continuation->multi_.get(),
-                              sockfd,
-                              socket_poller),
-                          CURLM_OK);
-                    }
-
-                    // Stops poll handle if it was started.
-                    if (uv_is_active((uv_handle_t*) socket_poller)) {
-                      CHECK_EQ(
-                          uv_poll_stop(
-                              (uv_poll_t*) socket_poller),
-                          0);
-                    }
-
-                    CHECK_EQ(
-                        uv_poll_start(
-                            (uv_poll_t*) socket_poller,
-                            events,
-                            poll_callback),
-                        0);
-
-                    break;
-                  case CURL_POLL_REMOVE:
-                    // Remove poll handle for this particular socket.
-                    uv_poll_stop((uv_poll_t*) socket_poller);
-                    uv_close(
-                        (uv_handle_t*) socket_poller,
-                        [](uv_handle_t* handle) {
-                          delete (uv_poll_t*) handle;
-                        });
-
-                    // Remove this poll handle from vector.
-                    for (auto it = continuation->polls_.begin();
-                         it != continuation->polls_.end();
-                         it++) {
-                      if (*it == (uv_poll_t*) socket_poller) {
-                        continuation->polls_.erase(it);
-                        break;
-                      }
-                    }
-
-                    // Remove assignment of poll handle to this socket.
-                    CHECK_EQ(
-                        curl_multi_assign(
-                            continuation->multi_.get(),
-                            sockfd,
-                            nullptr),
-                        CURLM_OK);
-                    break;
-                }
-              };
-
-              // Used by libcurl to set a timer after
-              // which we should start checking handles inside libcurl.
-              static auto timer_function = +[](CURLM* multi,
-                                               long timeout_ms,
-                                               Continuation* continuation) {
-                if (timeout_ms < 0) {
-                  timeout_ms = 0;
-                }
-
-                uv_timer_start(
-                    &continuation->timer_,
-                    timer_callback,
-                    timeout_ms,
-                    0);
-              };
+              if (request_.body_stream()) {
+                upload_.emplace(loop_, easy_, request_);
+              }
 
               // https://curl.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
               static auto write_function = +[](char* data,
@@ -867,213 +1098,311 @@ struct _HTTP final {
                                                 size_t size,
                                                 size_t nmemb,
                                                 Continuation* continuation) {
-                continuation->headers_buffer_ += std::string(
-                    data,
-                    size * nmemb);
+                // NOTE: appending directly (rather than via a temporary
+                // 'std::string') to avoid an allocation per header.
+                continuation->headers_buffer_.append(data, size * nmemb);
 
                 return nmemb * size;
               };
 
-              using std::chrono::duration_cast;
-              using std::chrono::milliseconds;
-
-              // CURL multi options.
-              CHECK_EQ(
-                  curl_multi_setopt(
-                      multi_.get(),
-                      CURLMOPT_SOCKETDATA,
-                      this),
-                  CURLM_OK);
-              CHECK_EQ(
-                  curl_multi_setopt(
-                      multi_.get(),
-                      CURLMOPT_SOCKETFUNCTION,
-                      socket_function),
-                  CURLM_OK);
-              CHECK_EQ(
-                  curl_multi_setopt(
-                      multi_.get(),
-                      CURLMOPT_TIMERDATA,
-                      this),
-                  CURLM_OK);
-              CHECK_EQ(
-                  curl_multi_setopt(
-                      multi_.get(),
-                      CURLMOPT_TIMERFUNCTION,
-                      timer_function),
-                  CURLM_OK);
-
-              // CURL easy options.
-              if (request_.verify_peer()) {
-                CHECK_EQ(
-                    curl_easy_setopt(
-                        easy_.get(),
-                        CURLOPT_SSL_VERIFYPEER,
-                        request_.verify_peer().value()),
-                    CURLE_OK);
-              }
-
-              switch (request_.method()) {
-                case Method::GET:
-                  CHECK_EQ(
-                      curl_easy_setopt(
-                          easy_.get(),
-                          CURLOPT_HTTPGET,
-                          1),
-                      CURLE_OK);
-                  break;
-                case Method::POST:
-                  // Converting PostFields.
-                  std::unique_ptr<
-                      CURLU,
-                      decltype(&curl_url_cleanup)>
-                      curl_url_handle(
-                          curl_url(),
-                          &curl_url_cleanup);
-                  CHECK_EQ(
-                      curl_url_set(
-                          curl_url_handle.get(),
-                          CURLUPART_URL,
-                          request_.uri().c_str(),
-                          0),
-                      CURLUE_OK);
-                  for (const auto& field : request_.fields()) {
-                    std::string combined =
-                        field.first
-                        + '='
-                        + field.second;
-                    CHECK_EQ(
-                        curl_url_set(
-                            curl_url_handle.get(),
-                            CURLUPART_QUERY,
-                            combined.c_str(),
-                            CURLU_APPENDQUERY | CURLU_URLENCODE),
-                        CURLUE_OK);
-                  }
-                  char* url_string = nullptr;
-                  CHECK_EQ(
-                      curl_url_get(
-                          curl_url_handle.get(),
-                          CURLUPART_QUERY,
-                          &url_string,
-                          0),
-                      CURLUE_OK);
-                  fields_string_ = std::unique_ptr<
-                      char,
-                      decltype(&curl_free)>(
-                      url_string,
-                      &curl_free);
-                  // End of conversion.
-
-                  CHECK_EQ(
-                      curl_easy_setopt(
-                          easy_.get(),
-                          CURLOPT_HTTPPOST,
-                          1),
-                      CURLE_OK);
-                  CHECK_EQ(
-                      curl_easy_setopt(
-                          easy_.get(),
-                          CURLOPT_POSTFIELDS,
-                          fields_string_.get()),
-                      CURLE_OK);
-
-                  break;
-              }
-
-              // Transform 'Request' headers to curl's linked list.
-              for (const auto& [key, value] : request_.headers()) {
-                std::string header = key + ": " + value;
-
-                // We should only be adding the headers once, so they
-                // shouldn't yet exist!
-                CHECK(!curl_headers_)
-                    << "not expecting to have already allocated headers";
-
-                curl_slist* list = nullptr;
-
-                // 'curl_slist_append()' copies 'header' so we don't
-                //  have to worry about its lifetime.
-                list = curl_slist_append(list, header.c_str());
-
-                curl_headers_ = std::unique_ptr<
-                    curl_slist,
-                    decltype(&curl_slist_free_all)>(
-                    CHECK_NOTNULL(list),
-                    &curl_slist_free_all);
-              }
-
-              CHECK_EQ(
-                  curl_easy_setopt(
-                      easy_.get(),
-                      CURLOPT_HTTPHEADER,
-                      curl_headers_.get()),
-                  CURLE_OK);
-              CHECK_EQ(
-                  curl_easy_setopt(
-                      easy_.get(),
-                      CURLOPT_URL,
-                      request_.uri().c_str()),
-                  CURLE_OK);
               CHECK_EQ(
                   curl_easy_setopt(
-                      easy_.get(),
+                      easy_,
                       CURLOPT_WRITEDATA,
                       this),
                   CURLE_OK);
               CHECK_EQ(
                   curl_easy_setopt(
-                      easy_.get(),
+                      easy_,
                       CURLOPT_WRITEFUNCTION,
                       write_function),
                   CURLE_OK);
               CHECK_EQ(
                   curl_easy_setopt(
-                      easy_.get(),
+                      easy_,
                       CURLOPT_HEADERDATA,
                       this),
                   CURLE_OK);
               CHECK_EQ(
                   curl_easy_setopt(
-                      easy_.get(),
+                      easy_,
                       CURLOPT_HEADERFUNCTION,
                       header_function),
                   CURLE_OK);
-              // Option to follow redirects.
-              CHECK_EQ(
-                  curl_easy_setopt(
-                      easy_.get(),
-                      CURLOPT_FOLLOWLOCATION,
-                      1),
-                  CURLE_OK);
-              // The internal mechanism of libcurl to provide timeout support.
-              // Not accurate at very low values.
-              // 0 means that transfer can run indefinitely.
+
+              done_ = [this](CURLcode result) {
+                Done(result);
+              };
+
+              // Start handling connection.
+              pool_->Add(easy_, &done_);
+            }
+          },
+          &context_);
+    }
+
+    template <typename Error>
+    void Fail(Error&& error) {
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          Pooled([this, error = std::forward<Error>(error)]() mutable {
+            k_.Fail(std::move(error));
+          }),
+          &context_);
+    }
+
+    void Stop() {
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          [this]() {
+            k_.Stop();
+          },
+          &context_);
+    }
+
+    void Register(Interrupt& interrupt) {
+      k_.Register(interrupt);
+
+      handler_.emplace(&interrupt, [this]() {
+        loop_.Submit(
+            [this]() {
+              if (!started_) {
+                CHECK(!completed_);
+                completed_ = true;
+                k_.Stop();
+              } else if (!completed_) {
+                CHECK(started_);
+                completed_ = true;
+                closed_ = true;
+
+                pool_->Remove(easy_);
+                pool_->Release(easy_);
+                easy_ = nullptr;
+
+                if (upload_) {
+                  upload_->Close([this]() {
+                    k_.Stop();
+                  });
+                } else {
+                  k_.Stop();
+                }
+              }
+            },
+            &interrupt_context_);
+      });
+
+      // NOTE: we always install the handler in case 'Start()'
+      // never gets called.
+      handler_->Install();
+    }
+
+   private:
+    // Invoked by '_ConnectionPool' once the transfer has completed.
+    void Done(CURLcode result) {
+      completed_ = true;
+      closed_ = true;
+
+      result_ = result;
+
+      if (result == CURLE_OK) {
+        curl_easy_getinfo(easy_, CURLINFO_RESPONSE_CODE, &code_);
+      }
+
+      // NOTE: we release the easy handle _before_ continuing because
+      // we might get deallocated once we've continued.
+      pool_->Release(easy_);
+      easy_ = nullptr;
+
+      if (upload_) {
+        upload_->Close([this]() {
+          Respond();
+        });
+      } else {
+        Respond();
+      }
+    }
+
+    // Continues with the 'Response' once any upload has been closed.
+    void Respond() {
+      if (upload_ && upload_->error()) {
+        k_.Fail(std::runtime_error(upload_->error().value()));
+      } else if (result_ == CURLE_OK) {
+        k_.Start(Response{
+            code_,
+            HeaderTable(std::move(headers_buffer_)),
+            body_buffer_.Extract()});
+      } else {
+        k_.Fail(std::runtime_error(curl_easy_strerror(result_)));
+      }
+    }
+
+    EventLoop& loop_;
+
+    Request request_;
+
+    std::shared_ptr<_ConnectionPool> pool_;
+
+    _Options options_;
+
+    CURL* easy_ = nullptr;
+
+    // Only if the request has a 'BodyStream'.
+    std::optional<_Upload> upload_;
+
+    Callback<void(CURLcode)> done_;
+
+    // Response variables.
+    CURLcode result_ = CURLE_OK;
+    long code_ = 0;
+    std::string headers_buffer_;
+    EventLoop::Buffer body_buffer_;
+
+    bool started_ = false;
+    bool completed_ = false;
+    bool closed_ = false;
+
+    // NOTE: we use 'context_' in each of 'Start()', 'Fail()', and
+    // 'Stop()' because only one of them will called at runtime.
+    Scheduler::Context context_;
+    Scheduler::Context interrupt_context_;
+
+    std::optional<Interrupt::Handler> handler_;
+
+    // NOTE: we store 'k_' as the _last_ member so it will be
+    // destructed _first_ and thus we won't have any use-after-delete
+    // issues during destruction of 'k_' if it holds any references or
+    // pointers to any (or within any) of the above members.
+    K_ k_;
+  };
+
+  struct Composable final {
+    template <typename Arg>
+    using ValueFrom = Response;
+
+    template <typename Arg, typename Errors>
+    using ErrorsFrom = tuple_types_union_t<
+        Errors,
+        std::tuple<std::runtime_error>>;
+
+    template <typename Arg, typename K>
+    auto k(K k) && {
+      return Continuation<K>(
+          std::move(k),
+          loop_,
+          std::move(request_),
+          std::move(pool_));
+    }
+
+    EventLoop& loop_;
+    Request request_;
+    std::shared_ptr<_ConnectionPool> pool_;
+  };
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Like '_HTTP' except rather than buffering the body we emit each
+// chunk downstream as soon as libcurl writes it.
+//
+// Backpressure: if libcurl writes a chunk before downstream has
+// called 'Next()' we pause receiving for the transfer by returning
+// 'CURL_WRITEFUNC_PAUSE' (equivalent to 'CURLPAUSE_RECV') and then
+// unpause it once downstream calls 'Next()', at which point libcurl
+// writes that same chunk again.
+//
+// NOTE: 'Next()', 'Done()', and any interrupt all get submitted to
+// the event loop so we only ever access our state (and libcurl) from
+// within the event loop.
+struct _HTTPStream final {
+  template <typename K_>
+  struct Continuation final : public TypeErasedStream {
+    // NOTE: explicit constructor because inheriting 'TypeErasedStream'.
+    Continuation(
+        K_ k,
+        EventLoop& loop,
+        Request&& request,
+        std::shared_ptr<_ConnectionPool> pool)
+      : loop_(loop),
+        request_(std::move(request)),
+        pool_(std::move(pool)),
+        context_(&loop, "HTTP stream (start/fail/stop)"),
+        stream_context_(&loop, "HTTP stream (next/done)"),
+        interrupt_context_(&loop, "HTTP stream (interrupt)"),
+        k_(std::move(k)) {}
+
+    Continuation(Continuation&& that)
+      : loop_(that.loop_),
+        request_(std::move(that.request_)),
+        pool_(std::move(that.pool_)),
+        options_(std::move(that.options_)),
+        context_(&that.loop_, "HTTP stream (start/fail/stop)"),
+        stream_context_(&that.loop_, "HTTP stream (next/done)"),
+        interrupt_context_(&that.loop_, "HTTP stream (interrupt)"),
+        k_(std::move(that.k_)) {
+      CHECK(!that.started_ || !that.completed_) << "moving after starting";
+      CHECK(!handler_);
+    }
+
+    ~Continuation() override {
+      CHECK(!started_ || closed_);
+    }
+
+    void Start() {
+      CHECK(!started_ && !completed_);
+
+      loop_.Submit(
+          [this]() {
+            if (!completed_) {
+              started_ = true;
+
+              easy_ = CHECK_NOTNULL(pool_->Acquire(loop_));
+
+              if (!options_.Set(easy_, request_)) {
+                completed_ = true;
+                closed_ = true;
+
+                pool_->Release(easy_);
+                easy_ = nullptr;
+
+                k_.Fail(std::runtime_error(
+                    "Failed to PEM encode certificate"));
+
+                return; // Don't do anything else!
+              }
+
+              if (request_.body_stream()) {
+                upload_.emplace(loop_, easy_, request_);
+              }
+
+              // https://curl.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
+              static auto write_function = +[](char* data,
+                                               size_t size,
+                                               size_t nmemb,
+                                               Continuation* continuation) {
+                return continuation->Write(data, size * nmemb);
+              };
+
               CHECK_EQ(
                   curl_easy_setopt(
-                      easy_.get(),
-                      CURLOPT_TIMEOUT_MS,
-                      duration_cast<milliseconds>(request_.timeout())),
+                      easy_,
+                      CURLOPT_WRITEDATA,
+                      this),
                   CURLE_OK);
-              // If onoff is 1, libcurl will not use any functions that install
-              // signal handlers or any functions that cause signals to be sent
-              // to the process. This option is here to allow multi-threaded
-              // unix applications to still set/use all timeout options etc,
-              // without risking getting signals.
-              // More here: https://curl.se/libcurl/c/CURLOPT_NOSIGNAL.html
               CHECK_EQ(
                   curl_easy_setopt(
-                      easy_.get(),
-                      CURLOPT_NOSIGNAL,
-                      1),
+                      easy_,
+                      CURLOPT_WRITEFUNCTION,
+                      write_function),
                   CURLE_OK);
 
+              done_ = [this](CURLcode result) {
+                Finished(result);
+              };
+
               // Start handling connection.
-              CHECK_EQ(
-                  curl_multi_add_handle(
-                      multi_.get(),
-                      easy_.get()),
-                  CURLM_OK);
+              pool_->Add(easy_, &done_);
+
+              k_.Begin(*this);
             }
           },
           &context_);
@@ -1081,23 +1410,11 @@ struct _HTTP final {
 
     template <typename Error>
     void Fail(Error&& error) {
-      // TODO(benh): avoid allocating on heap by storing args in
-      // pre-allocated buffer based on composing with Errors.
-      using Tuple = std::tuple<decltype(this), Error>;
-      auto tuple = std::make_unique<Tuple>(
-          this,
-          std::forward<Error>(error));
-
       // Submitting to event loop to avoid race with interrupt.
       loop_.Submit(
-          [tuple = std::move(tuple)]() {
-            std::apply(
-                [](auto* continuation, auto&&... args) {
-                  auto& k_ = continuation->k_;
-                  k_.Fail(std::forward<decltype(args)>(args)...);
-                },
-                std::move(*tuple));
-          },
+          Pooled([this, error = std::forward<Error>(error)]() mutable {
+            k_.Fail(std::move(error));
+          }),
           &context_);
     }
 
@@ -1117,43 +1434,23 @@ struct _HTTP final {
         loop_.Submit(
             [this]() {
               if (!started_) {
-                CHECK(!completed_ && !error_);
+                CHECK(!completed_);
                 completed_ = true;
                 k_.Stop();
               } else if (!completed_) {
-                CHECK(started_ && !error_);
-                completed_ = true;
-
-                for (auto& poll : polls_) {
-                  if (uv_is_active((uv_handle_t*) poll)) {
-                    uv_poll_stop(poll);
+                Abort();
+
+                CloseUpload([this]() {
+                  // Downstream might still be processing the last
+                  // chunk in which case we stop once it asks for the
+                  // next one (or is done).
+                  if (cancelled_ || requested_) {
+                    requested_ = false;
+                    k_.Stop();
+                  } else {
+                    interrupted_ = true;
                   }
-                  uv_close(
-                      (uv_handle_t*) poll,
-                      [](uv_handle_t* handle) {
-                        delete handle;
-                      });
-                }
-                polls_.clear();
-
-                // We don't have to check uv_is_active for timer since
-                // libuv checks it by itself.
-                // Return value is always 0.
-                uv_timer_stop(&timer_);
-                uv_close(
-                    (uv_handle_t*) &timer_,
-                    [](uv_handle_t* handle) {
-                      auto& continuation = *(Continuation*) handle->data;
-                      continuation.closed_ = true;
-
-                      continuation.k_.Stop();
-                    });
-
-                CHECK_EQ(
-                    curl_multi_remove_handle(
-                        multi_.get(),
-                        easy_.get()),
-                    CURLM_OK);
+                });
               }
             },
             &interrupt_context_);
@@ -1164,35 +1461,217 @@ struct _HTTP final {
       handler_->Install();
     }
 
+    void Next() override {
+      stream_context_.Continue([this]() {
+        CHECK(started_);
+        CHECK(!requested_);
+
+        if (interrupted_) {
+          k_.Stop();
+        } else if (result_) {
+          End();
+        } else {
+          requested_ = true;
+
+          if (paused_ && !completed_) {
+            paused_ = false;
+
+            // NOTE: libcurl might invoke the write function (and thus
+            // 'k_.Body()') before this returns. We ignore the result
+            // because any error will be reported when the transfer
+            // completes.
+            curl_easy_pause(easy_, CURLPAUSE_CONT);
+          }
+        }
+      });
+    }
+
+    void Done() override {
+      stream_context_.Continue([this]() {
+        CHECK(started_);
+
+        if (interrupted_) {
+          k_.Stop();
+        } else if (closing_) {
+          // We'll end once the upload has closed.
+          cancelled_ = true;
+        } else if (completed_) {
+          k_.Ended();
+        } else if (writing_) {
+          // Downstream is done from within 'k_.Body()' which means
+          // we're still inside of libcurl (where we can't remove the
+          // easy handle) so we have 'Write()' fail the transfer
+          // instead and end once the pool tells us it has completed.
+          cancelled_ = true;
+        } else {
+          Abort();
+
+          CloseUpload([this]() {
+            k_.Ended();
+          });
+        }
+      });
+    }
+
    private:
+    // Invoked by libcurl for each chunk of the body.
+    size_t Write(char* data, size_t size) {
+      // Fail the transfer before propagating any chunks of the body
+      // of an error response (e.g., a 404 or 500 error page) so that
+      // downstream can't mistake it for the body it asked for.
+      if (code_ == 0) {
+        curl_easy_getinfo(easy_, CURLINFO_RESPONSE_CODE, &code_);
+      }
+
+      if (code_ >= 400) {
+        // Returning anything other than 'size' fails the transfer,
+        // see 'End()'.
+        return 0;
+      }
+
+      if (!requested_) {
+        paused_ = true;
+        return CURL_WRITEFUNC_PAUSE;
+      }
+
+      requested_ = false;
+
+      writing_ = true;
+      k_.Body(std::string(data, size));
+      writing_ = false;
+
+      // Returning anything other than 'size' fails the transfer.
+      return cancelled_ ? 0 : size;
+    }
+
+    // Invoked by '_ConnectionPool' once the transfer has completed.
+    void Finished(CURLcode result) {
+      completed_ = true;
+      closed_ = true;
+
+      // NOTE: we might not have gotten the status code in 'Write()'
+      // if the response didn't have a body.
+      if (code_ == 0) {
+        curl_easy_getinfo(easy_, CURLINFO_RESPONSE_CODE, &code_);
+      }
+
+      // NOTE: we release the easy handle _before_ continuing because
+      // we might get deallocated once we've continued.
+      pool_->Release(easy_);
+      easy_ = nullptr;
+
+      CloseUpload([this, result]() {
+        if (cancelled_) {
+          k_.Ended();
+        } else {
+          result_ = result;
+
+          // Otherwise we'll end once downstream asks for the next
+          // chunk.
+          if (requested_) {
+            requested_ = false;
+            End();
+          }
+        }
+      });
+    }
+
+    // Ends the stream (or fails it if the transfer or upload failed
+    // or the response has an error status code).
+    void End() {
+      if (upload_ && upload_->error()) {
+        k_.Fail(std::runtime_error(upload_->error().value()));
+      } else if (code_ >= 400) {
+        k_.Fail(std::runtime_error(
+            "HTTP request failed with status code "
+            + std::to_string(code_)));
+      } else if (result_.value() == CURLE_OK) {
+        k_.Ended();
+      } else {
+        k_.Fail(std::runtime_error(curl_easy_strerror(result_.value())));
+      }
+    }
+
+    // Aborts an outstanding transfer.
+    void Abort() {
+      completed_ = true;
+      closed_ = true;
+
+      pool_->Remove(easy_);
+      pool_->Release(easy_);
+      easy_ = nullptr;
+    }
+
+    // Invokes 'closed' once any upload has been closed.
+    void CloseUpload(Callback<void()> closed) {
+      if (upload_) {
+        closing_ = true;
+        closed_upload_ = std::move(closed);
+        upload_->Close([this]() {
+          closing_ = false;
+          closed_upload_();
+        });
+      } else {
+        closed();
+      }
+    }
+
     EventLoop& loop_;
 
     Request request_;
 
-    // Stores converted PostFields as a C string.
-    std::unique_ptr<char, decltype(&curl_free)> fields_string_;
+    std::shared_ptr<_ConnectionPool> pool_;
 
-    std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> easy_;
-    std::unique_ptr<CURLM, decltype(&curl_multi_cleanup)> multi_;
-    std::unique_ptr<curl_slist, decltype(&curl_slist_free_all)> curl_headers_;
+    _Options options_;
 
-    uv_timer_t timer_;
-    std::vector<uv_poll_t*> polls_;
+    CURL* easy_ = nullptr;
 
-    // Response variables.
+    // Only if the request has a 'BodyStream'.
+    std::optional<_Upload> upload_;
+
+    Callback<void()> closed_upload_;
+
+    Callback<void(CURLcode)> done_;
+
+    // Result of the transfer once it has completed.
+    std::optional<CURLcode> result_;
+
+    // Status code of the response, or 0 until we've gotten it.
     long code_ = 0;
-    EventLoop::Buffer headers_buffer_;
-    EventLoop::Buffer body_buffer_;
 
     bool started_ = false;
     bool completed_ = false;
     bool closed_ = false;
 
-    int error_ = 0;
+    // Whether or not downstream has called 'Next()' and is waiting
+    // for a chunk (or for the stream to end).
+    bool requested_ = false;
+
+    // Whether or not receiving has been paused, see 'Write()'.
+    bool paused_ = false;
+
+    // Whether or not we're in 'k_.Body()' from within 'Write()'.
+    bool writing_ = false;
+
+    // Whether or not we're waiting for the upload to close.
+    bool closing_ = false;
+
+    // Whether or not downstream called 'Done()' while 'writing_' (or
+    // while 'closing_').
+    bool cancelled_ = false;
+
+    // Whether or not we were interrupted while downstream was still
+    // processing a chunk.
+    bool interrupted_ = false;
 
     // NOTE: we use 'context_' in each of 'Start()', 'Fail()', and
     // 'Stop()' because only one of them will called at runtime.
     Scheduler::Context context_;
+
+    // NOTE: we use 'stream_context_' for both 'Next()' and 'Done()'
+    // since downstream only calls one of them at a time.
+    Scheduler::Context stream_context_;
+
     Scheduler::Context interrupt_context_;
 
     std::optional<Interrupt::Handler> handler_;
@@ -1206,7 +1685,7 @@ struct _HTTP final {
 
   struct Composable final {
     template <typename Arg>
-    using ValueFrom = Response;
+    using ValueFrom = std::string;
 
     template <typename Arg, typename Errors>
     using ErrorsFrom = tuple_types_union_t<
@@ -1215,20 +1694,22 @@ struct _HTTP final {
 
     template <typename Arg, typename K>
     auto k(K k) && {
-      return Continuation<K>(std::move(k), loop_, std::move(request_));
+      return Continuation<K>(
+          std::move(k),
+          loop_,
+          std::move(request_),
+          std::move(pool_));
     }
 
     EventLoop& loop_;
     Request request_;
+    std::shared_ptr<_ConnectionPool> pool_;
   };
 };
 
 ////////////////////////////////////////////////////////////////////////
 
-inline auto Client::Do(Request&& request) {
-  // TODO(benh): need 'Client::Default()'.
-  auto& loop = EventLoop::Default();
-
+inline void Client::Inherit(Request& request) {
   if (verify_peer_.has_value() && !request.verify_peer().has_value()) {
     request.verify_peer_ = verify_peer_;
   }
@@ -1236,13 +1717,37 @@ inline auto Client::Do(Request&& request) {
   if (certificate_.has_value() && !request.certificate().has_value()) {
     request.certificate_ = certificate_;
   }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+inline auto Client::Do(Request&& request) {
+  auto& loop = this->loop();
+
+  Inherit(request);
 
   // NOTE: we use a 'RescheduleAfter()' to ensure we use current
   // scheduling context to invoke the continuation after the transfer has
   // completed (or was interrupted).
   return RescheduleAfter(
       // TODO(benh): borrow '&loop' so http call can't outlive a loop.
-      _HTTP::Composable{loop, std::move(request)});
+      _HTTP::Composable{loop, std::move(request), pool_});
+}
+
+////////////////////////////////////////////////////////////////////////
+
+inline auto Client::Stream(Request&& request) {
+  auto& loop = this->loop();
+
+  Inherit(request);
+
+  // NOTE: we use a 'RescheduleAfter()' to ensure we use current
+  // scheduling context to invoke the continuation for each chunk of
+  // the body (as well as after the transfer has completed or was
+  // interrupted).
+  return RescheduleAfter(
+      // TODO(benh): borrow '&loop' so http call can't outlive a loop.
+      _HTTPStream::Composable{loop, std::move(request), pool_});
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -199,25 +199,13 @@ struct _Acquire final {
       if (lock_->AcquireFast(&waiter_)) {
         k_.Fail(std::move(error));
       } else {
-        // TODO(benh): avoid allocating on heap by storing args in
-        // pre-allocated buffer based on composing with Errors.
-        using Tuple = std::tuple<decltype(this), Error>;
-        auto tuple = std::make_unique<Tuple>(
-            this,
-            std::forward<Error>(error));
-
-        waiter_.f = [tuple = std::move(tuple)]() mutable {
-          auto* acquire = std::get<0>(*tuple);
-          acquire->waiter_.context->Unblock(
-              [tuple = std::move(tuple)]() mutable {
-                std::apply(
-                    [](auto* acquire, auto&&... args) {
-                      auto& k_ = acquire->k_;
-                      k_.Fail(std::forward<decltype(args)>(args)...);
-                    },
-                    std::move(*tuple));
-              });
-        };
+        waiter_.f = Pooled(
+            [this, error = std::forward<Error>(error)]() mutable {
+              waiter_.context->Unblock(
+                  Pooled([this, error = std::move(error)]() mutable {
+                    k_.Fail(std::move(error));
+                  }));
+            });
 
         if (lock_->AcquireSlow(&waiter_)) {
           // TODO(benh): while this isn't the "fast path" we'll do a
@@ -735,36 +723,46 @@ class ConditionVariable final {
           constexpr bool using_empty_condition =
               std::is_same_v<F, EmptyCondition>;
 
-          // Helper to determine if we need to wait or not.
-          auto should_wait = [&]() {
+          // Assign `nofify` callback to `waiter` for later use.
+          waiter.notify = std::move(notify);
+
+          // Helper to determine if we need to wait or not which gets
+          // called every time we've been notified.
+          //
+          // If we should wait, the `waiter` needs to be enqueued with
+          // other waiters so it can later be notified, including
+          // after it has already been notified once but the condition
+          // still requires waiting (e.g., because another waiter was
+          // notified first and "consumed" what we were waiting for).
+          return [&]() {
+            bool wait = false;
             if constexpr (using_empty_condition) {
-              return f(waiter);
+              wait = f(waiter);
             } else {
-              return f();
+              wait = f();
             }
-          };
 
-          // If we should wait, the `waiter` need to be
-          // enqueued with other waiters so it can later be notified.
-          if (should_wait()) {
-            // Assign `nofify` callback to `waiter` for later use.
-            waiter.notify = std::move(notify);
-
-            // Add `waiter` to list of waiters. The below might look convoluted
-            // at first but is a text book "append" to a linked list.
-            if (head_ == nullptr) {
-              head_ = &waiter;
-            } else if (head_->next == nullptr) {
-              head_->next = &waiter;
-            } else {
-              auto* next = head_->next;
-              while (next->next != nullptr) {
-                next = next->next;
+            if (wait && !waiter.enqueued) {
+              waiter.enqueued = true;
+
+              // Add `waiter` to list of waiters. The below might look
+              // convoluted at first but is a text book "append" to a
+              // linked list.
+              if (head_ == nullptr) {
+                head_ = &waiter;
+              } else if (head_->next == nullptr) {
+                head_->next = &waiter;
+              } else {
+                auto* next = head_->next;
+                while (next->next != nullptr) {
+                  next = next->next;
+                }
+                next->next = &waiter;
               }
-              next->next = &waiter;
             }
-          }
-          return should_wait;
+
+            return wait;
+          };
         });
   }
 
@@ -783,6 +781,7 @@ class ConditionVariable final {
       head_ = waiter->next;
 
       waiter->next = nullptr;
+      waiter->enqueued = false;
       waiter->notified = true;
       waiter->notify();
     }
@@ -807,6 +806,7 @@ class ConditionVariable final {
   struct Waiter {
     Callback<void()> notify;
     bool notified = false;
+    bool enqueued = false;
     Waiter* next = nullptr;
   };
 
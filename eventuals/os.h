@@ -62,6 +62,20 @@ inline void SetAffinity(std::thread& thread, const size_t cpu) {
 
 ////////////////////////////////////////////////////////////////////////
 
+// Hints to the CPU that we're in a spin loop so that it can, e.g.,
+// save power or give more resources to a sibling hyperthread.
+inline void PauseCPU() {
+#if _WIN32
+  YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield");
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+
 } // namespace eventuals
 
 ////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <limits>
+
+#include "eventuals/closure.h"
+#include "eventuals/concurrent-ordered.h"
+#include "eventuals/concurrent.h"
+#include "eventuals/static-thread-pool.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+struct _ParallelConcurrent final {
+  // Returns a callable that wraps the eventual returned from calling
+  // 'f' so that it gets scheduled on the specified static thread pool.
+  //
+  // Every invocation gets its own requirements which are placed
+  // (once, when first scheduled) on the least loaded CPU, thus
+  // spreading the fibers across all of the CPUs of the pool. Values
+  // emitted from the eventual are rescheduled back onto the fiber's
+  // context and then flow through the usual 'Concurrent()' egress.
+  template <typename F>
+  static auto Schedule(StaticThreadPool& pool, F f) {
+    return [&pool, f = std::move(f)]() {
+      return Closure([&pool,
+                      e = f(),
+                      requirements = StaticThreadPool::Requirements(
+                          "[parallel concurrent fiber]")]() mutable {
+        return pool.Schedule(&requirements, std::move(e));
+      });
+    };
+  }
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Like 'Concurrent(n, f)' except each eventual returned from calling
+// 'f' gets scheduled on a CPU of the specified static thread pool
+// instead of on the default preemptive scheduler, i.e., the fibers
+// run in parallel. Since the eventuals may run on different threads
+// at the same time, 'f' (and anything it references) must be safe to
+// use from multiple threads!
+template <typename F>
+auto ParallelConcurrent(StaticThreadPool& pool, size_t n, F f) {
+  static_assert(
+      std::is_invocable_v<F>,
+      "ParallelConcurrent expects callable that takes no arguments");
+
+  return Concurrent(n, _ParallelConcurrent::Schedule(pool, std::move(f)));
+}
+
+////////////////////////////////////////////////////////////////////////
+
+template <typename F>
+auto ParallelConcurrent(StaticThreadPool& pool, F f) {
+  return ParallelConcurrent(
+      pool,
+      std::numeric_limits<size_t>::max(),
+      std::move(f));
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Like 'ParallelConcurrent(pool, n, f)' except values are emitted in
+// the same order as upstream, see 'ConcurrentOrdered(n, f)'.
+template <typename F>
+auto ParallelConcurrentOrdered(StaticThreadPool& pool, size_t n, F f) {
+  static_assert(
+      std::is_invocable_v<F>,
+      "ParallelConcurrentOrdered expects callable that takes no arguments");
+
+  return ConcurrentOrdered(
+      n,
+      _ParallelConcurrent::Schedule(pool, std::move(f)));
+}
+
+////////////////////////////////////////////////////////////////////////
+
+template <typename F>
+auto ParallelConcurrentOrdered(StaticThreadPool& pool, F f) {
+  return ParallelConcurrentOrdered(
+      pool,
+      std::numeric_limits<size_t>::max(),
+      std::move(f));
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -1,5 +1,8 @@
 #include "eventuals/scheduler.h"
 
+#include <mutex>
+#include <set>
+
 #include "glog/logging.h" // For GetTID().
 
 ////////////////////////////////////////////////////////////////////////
@@ -72,6 +75,27 @@ Scheduler* Scheduler::Default() {
 
 ////////////////////////////////////////////////////////////////////////
 
+StaticName StaticName::Intern(std::string_view name) {
+  // NOTE: using a 'std::set' rather than a 'std::unordered_set' for
+  // lookups with a 'std::string_view' without constructing a
+  // 'std::string'. Never deallocated so interned names stay valid
+  // even while other static objects are being destructed.
+  static auto* mutex = new std::mutex();
+  static auto* names = new std::set<std::string, std::less<>>();
+
+  std::scoped_lock lock(*mutex);
+
+  auto iterator = names->find(name);
+
+  if (iterator == names->end()) {
+    iterator = names->emplace(name).first;
+  }
+
+  return StaticName(iterator->c_str(), Interned());
+}
+
+////////////////////////////////////////////////////////////////////////
+
 static thread_local Scheduler::Context context(
     Scheduler::Default(),
     "[" + std::to_string(static_cast<unsigned int>(GetTID())) + "]");
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <atomic>
 #include <functional> // For 'std::reference_wrapper'.
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 
 #include "eventuals/callback.h"
 #include "eventuals/closure.h"
@@ -18,6 +21,41 @@ namespace eventuals {
 
 ////////////////////////////////////////////////////////////////////////
 
+// A name with static storage duration, i.e., a string literal or an
+// interned name (see 'Intern()'), which can be used without being
+// copied and thus without allocating. A distinct type (rather than
+// just a 'const char*') so that a name which might not outlive its
+// use, e.g., from 'std::string::c_str()', fails to compile.
+class StaticName final {
+ public:
+  // Returns a name that is equal to 'name' where the same pointer is
+  // returned for equal names.
+  //
+  // NOTE: interned names are never deallocated so only intern names
+  // that come from a bounded set!
+  static StaticName Intern(std::string_view name);
+
+  template <size_t N>
+  constexpr StaticName(const char (&literal)[N])
+    : name_(literal) {}
+
+  const char* c_str() const {
+    return name_;
+  }
+
+ private:
+  // NOTE: using a tag so that this constructor isn't preferred over
+  // the one for string literals (since it's not a template).
+  struct Interned {};
+
+  constexpr StaticName(const char* name, Interned)
+    : name_(name) {}
+
+  const char* name_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
 class Scheduler {
  public:
   struct Context final {
@@ -35,16 +73,76 @@ class Scheduler {
       return CHECK_NOTNULL(previous);
     }
 
-    Context(Scheduler* scheduler, const std::string& name, void* data = nullptr)
+    // NOTE: doesn't copy 'name' which keeps constructing a context
+    // allocation free, see 'StaticName'.
+    Context(Scheduler* scheduler, StaticName name, void* data = nullptr)
+      : data(data),
+        scheduler_(CHECK_NOTNULL(scheduler)),
+        name_(name.c_str()) {}
+
+    template <size_t N>
+    Context(Scheduler* scheduler, const char (&name)[N], void* data = nullptr)
+      : Context(scheduler, StaticName(name), data) {}
+
+    // NOTE: copies 'name' which might allocate, prefer using a string
+    // literal or an interned name (see 'StaticName::Intern()') when
+    // constructing contexts frequently.
+    Context(Scheduler* scheduler, std::string name, void* data = nullptr)
+      : data(data),
+        scheduler_(CHECK_NOTNULL(scheduler)),
+        owned_(std::move(name)),
+        name_(owned_) {}
+
+    // Tag for constructing a context with a name that neither gets
+    // copied nor is a 'StaticName', i.e., the caller must make sure
+    // that the name outlives the context.
+    struct Borrowed {};
+
+    Context(
+        Scheduler* scheduler,
+        std::string_view name,
+        Borrowed,
+        void* data = nullptr)
       : data(data),
         scheduler_(CHECK_NOTNULL(scheduler)),
         name_(name) {}
 
-    Context(const std::string& name)
+    // A 'const char*' might not outlive the context, use a
+    // 'StaticName' or a 'std::string' instead.
+    template <
+        typename T,
+        std::enable_if_t<
+            std::is_same_v<T, const char*> || std::is_same_v<T, char*>,
+            int> = 0>
+    Context(Scheduler* scheduler, T name, void* data = nullptr) = delete;
+
+    Context(StaticName name)
       : Context(Context::Get()->scheduler(), name) {
       scheduler()->Clone(this);
     }
 
+    template <size_t N>
+    Context(const char (&name)[N])
+      : Context(StaticName(name)) {}
+
+    Context(std::string name)
+      : Context(Context::Get()->scheduler(), std::move(name)) {
+      scheduler()->Clone(this);
+    }
+
+    Context(std::string_view name, Borrowed)
+      : Context(Context::Get()->scheduler(), name, Borrowed()) {
+      scheduler()->Clone(this);
+    }
+
+    // See comment above.
+    template <
+        typename T,
+        std::enable_if_t<
+            std::is_same_v<T, const char*> || std::is_same_v<T, char*>,
+            int> = 0>
+    Context(T name) = delete;
+
     Context(const Context& that) = delete;
 
     Context(Context&& that) = delete;
@@ -67,7 +165,7 @@ class Scheduler {
       return blocked_;
     }
 
-    const std::string& name() {
+    std::string_view name() {
       return name_;
     }
 
@@ -109,6 +207,11 @@ class Scheduler {
     // "unblocks"/"resumes" the context.
     Callback<void()> callback;
 
+    // Schedulers with more than one queue can use 'queue' to remember
+    // which one the context was submitted to, e.g., so that any
+    // accounting gets undone for the same queue.
+    size_t queue = 0;
+
    private:
     static thread_local Context* current_;
 
@@ -117,7 +220,77 @@ class Scheduler {
     // There is the most common set of variables to create contexts.
     bool blocked_ = false;
 
-    std::string name_;
+    // Storage for the name if it wasn't a string literal, interned or
+    // borrowed.
+    //
+    // NOTE: must be declared before 'name_' since 'name_' might refer
+    // to it (which is safe because contexts can't be moved).
+    std::string owned_;
+
+    std::string_view name_;
+  };
+
+  // Intrusive multiple-producer single-consumer FIFO queue of
+  // contexts that uses 'Context::next' so that schedulers can queue
+  // contexts without allocating.
+  //
+  // Producers push onto a lock-free stack while the consumer takes
+  // the entire stack at once and reverses it locally, so dequeuing
+  // is O(1) per context no matter how many have been pushed.
+  class Queue final {
+   public:
+    Queue() = default;
+
+    Queue(const Queue&) = delete;
+
+    // Can be called from any thread.
+    void Push(Context* context) {
+      context->next = stack_.load(std::memory_order_relaxed);
+
+      while (!stack_.compare_exchange_weak(
+          context->next,
+          context,
+          std::memory_order_release,
+          std::memory_order_relaxed)) {}
+    }
+
+    // Returns the least recently pushed context or nullptr if the
+    // queue is empty. Must only be called by a single consumer!
+    Context* Pop() {
+      if (local_ == nullptr
+          && stack_.load(std::memory_order_relaxed) != nullptr) {
+        auto* context = stack_.exchange(nullptr, std::memory_order_acquire);
+        while (context != nullptr) {
+          auto* next = context->next;
+          context->next = local_;
+          local_ = context;
+          context = next;
+        }
+      }
+
+      auto* context = local_;
+
+      if (context != nullptr) {
+        local_ = context->next;
+        context->next = nullptr;
+      }
+
+      return context;
+    }
+
+    // Returns true if the queue is empty. Must only be called by the
+    // single consumer!
+    bool Empty() {
+      return local_ == nullptr
+          && stack_.load(std::memory_order_relaxed) == nullptr;
+    }
+
+   private:
+    std::atomic<Context*> stack_ = nullptr;
+
+    // Contexts taken from 'stack_' in FIFO order, only ever accessed
+    // by the consumer.
+    Context* local_ = nullptr;
   };
 
   virtual ~Scheduler() = default;
@@ -177,20 +350,10 @@ struct _Reschedule final {
             k_.Fail(std::forward<Error>(error));
           },
           [&]() {
-            // TODO(benh): avoid allocating on heap by storing args in
-            // pre-allocated buffer based on composing with Errors.
-            using Tuple = std::tuple<decltype(&k_), Error>;
-            auto tuple = std::make_unique<Tuple>(
-                &k_,
-                std::forward<Error>(error));
-
-            return [tuple = std::move(tuple)]() mutable {
-              std::apply(
-                  [](auto* k_, auto&&... args) {
-                    k_->Fail(std::forward<decltype(args)>(args)...);
-                  },
-                  std::move(*tuple));
-            };
+            return Pooled(
+                [this, error = std::forward<Error>(error)]() mutable {
+                  k_.Fail(std::move(error));
+                });
           });
     }
 
@@ -1,5 +1,7 @@
 #include "eventuals/static-thread-pool.h"
 
+#include <algorithm>
+
 #include "eventuals/os.h"
 
 ////////////////////////////////////////////////////////////////////////
@@ -8,15 +10,101 @@ namespace eventuals {
 
 ////////////////////////////////////////////////////////////////////////
 
+// Chase-Lev work-stealing deque, see "Dynamic Circular Work-Stealing
+// Deque" by Chase and Lev, using the memory orderings from "Correct
+// and Efficient Work-Stealing for Weak Memory Models" by Lê et al.
+//
+// Only the thread of the CPU that owns the deque may call 'Push()'
+// (which operates on the bottom of the deque) while any thread may
+// call 'Steal()' (which operates on the top of the deque).
+//
+// NOTE: unlike a classic Chase-Lev deque the owner doesn't take from
+// the bottom, which would resume contexts in the reverse order that
+// they were submitted, but instead calls 'Pop()' which takes from the
+// top just like a thief so contexts get resumed in FIFO order.
+//
+// NOTE: the deque has a fixed capacity rather than growing so that
+// we never have to reclaim a buffer that a thief might be reading
+// from, hence 'Push()' returns false when the deque is full.
+class StaticThreadPool::Deque final {
+ public:
+  bool Push(Context* context) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+
+    if (bottom - top >= CAPACITY) {
+      return false;
+    }
+
+    contexts_[bottom % CAPACITY].store(context, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  Context* Steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+    if (top < bottom) {
+      Context* context =
+          contexts_[top % CAPACITY].load(std::memory_order_relaxed);
+      if (top_.compare_exchange_strong(
+              top,
+              top + 1,
+              std::memory_order_seq_cst,
+              std::memory_order_relaxed)) {
+        return context;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Like 'Steal()' but retries if we lost a race with a thief so that
+  // we only return nullptr if the deque was actually empty.
+  //
+  // NOTE: only the owner may call 'Pop()' since otherwise it might
+  // retry forever while the owner keeps pushing.
+  Context* Pop() {
+    while (!Empty()) {
+      Context* context = Steal();
+      if (context != nullptr) {
+        return context;
+      }
+    }
+    return nullptr;
+  }
+
+  bool Empty() {
+    return bottom_.load(std::memory_order_relaxed)
+        <= top_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr int64_t CAPACITY = 1024;
+
+  alignas(64) std::atomic<int64_t> top_ = 0;
+  alignas(64) std::atomic<int64_t> bottom_ = 0;
+  std::atomic<Context*> contexts_[CAPACITY] = {};
+};
+
+////////////////////////////////////////////////////////////////////////
+
 StaticThreadPool::StaticThreadPool()
-  : concurrency(std::thread::hardware_concurrency()) {
-  semaphores_.reserve(concurrency);
-  heads_.reserve(concurrency);
+  : concurrency(std::thread::hardware_concurrency()),
+    states_(concurrency) {
+  deques_.reserve(concurrency);
+  queues_.reserve(concurrency);
   threads_.reserve(concurrency);
   for (size_t cpu = 0; cpu < concurrency; cpu++) {
-    semaphores_.emplace_back();
-    heads_.emplace_back();
+    deques_.emplace_back(new Deque());
+    queues_.emplace_back();
     ready_.emplace_back();
+  }
+  for (size_t cpu = 0; cpu < concurrency; cpu++) {
     threads_.emplace_back(
         [this, cpu]() {
           StaticThreadPool::member = true;
@@ -24,69 +112,99 @@ StaticThreadPool::StaticThreadPool()
 
           SetAffinity(threads_[cpu], cpu);
 
+          states_[cpu].context = Context::Get();
+
           EVENTUALS_LOG(3)
               << "Thread " << cpu << " (id=" << std::this_thread::get_id()
               << ") is running on core " << GetRunningCPU();
 
-          // NOTE: we store each 'semaphore' and 'head' in each thread
-          // so as to hopefully get less false sharing when other
-          // threads are trying to enqueue a waiter.
-          Semaphore semaphore;
-          std::atomic<Context*> head = nullptr;
+          // NOTE: we store each 'queue' in each thread so as to
+          // hopefully get less false sharing when other threads are
+          // trying to enqueue a waiter.
+          Queue queue;
 
-          semaphores_[cpu] = &semaphore;
-          heads_[cpu] = &head;
+          queues_[cpu] = &queue;
+
+          auto& deque = *deques_[cpu];
 
           ready_[cpu].Signal();
 
-          do {
-            semaphore.Wait();
-
-          load:
-            auto* context = head.load(std::memory_order_relaxed);
-
-            if (context != nullptr) {
-              if (context->next == nullptr) {
-                if (!head.compare_exchange_weak(
-                        context,
-                        nullptr,
-                        std::memory_order_release,
-                        std::memory_order_relaxed)) {
-                  goto load; // Try again.
-                }
-              } else {
-                while (context->next->next != nullptr) {
-                  context = context->next;
-                }
+          while (!shutdown_.load()) {
+            // Handle any events that are ready, see 'Poller'.
+            Poll(cpu);
 
-                assert(context->next != nullptr);
+            // Any contexts that can be stolen get moved onto our
+            // deque until we find one that can't be stolen (or
+            // doesn't fit in our deque) which we'll resume next.
+            Context* context = queue.Pop();
 
-                auto* next = context->next;
-                context->next = nullptr;
-                context = next;
+            while (context != nullptr) {
+              auto* requirements =
+                  static_cast<StaticThreadPool::Requirements*>(context->data);
+
+              if (!requirements->stealable) {
+                break;
+              }
+
+              // NOTE: we count the context before pushing it so that
+              // a thief that steals it right away never decrements
+              // 'stealable_' below zero.
+              stealable_.fetch_add(1, std::memory_order_relaxed);
+
+              if (deque.Push(context)) {
+                context = queue.Pop();
+              } else {
+                stealable_.fetch_sub(1, std::memory_order_relaxed);
+                break;
               }
+            }
+
+            if (context == nullptr) {
+              context = deque.Pop();
+              if (context != nullptr) {
+                stealable_.fetch_sub(1, std::memory_order_relaxed);
+              }
+            }
 
-              CHECK_NOTNULL(context);
+            if (context == nullptr) {
+              context = Steal(cpu);
+            }
 
-              CHECK_EQ(nullptr, context->next);
+            if (context == nullptr) {
+              Idle(cpu, queue);
+              continue;
+            }
 
-              Context::Set(context);
+            // Let another CPU help out if we have more contexts that
+            // can be stolen.
+            if (!deque.Empty()) {
+              Wake(cpu);
+            }
 
-              context->unblock();
+            CHECK_EQ(nullptr, context->next);
 
-              EVENTUALS_LOG(1) << "Resuming '" << context->name() << "'";
+            // NOTE: we undo the load on the CPU that 'Submit()'
+            // charged, which isn't ours if we stole the context.
+            states_[context->queue].load.fetch_sub(
+                1,
+                std::memory_order_relaxed);
 
-              CHECK(context->callback);
-              context->callback();
+            Context::Set(context);
 
-              CHECK_EQ(context, Context::Get());
+            context->unblock();
 
-              ////////////////////////////////////////////////////
-              // NOTE: can't use 'waiter' at this point in time //
-              // because it might have been deallocated!        //
-              ////////////////////////////////////////////////////
-            }
-          } while (!shutdown_.load());
+            EVENTUALS_LOG(1) << "Resuming '" << context->name() << "'";
+
+            CHECK(context->callback);
+            context->callback();
+
+            CHECK_EQ(context, Context::Get());
+
+            ////////////////////////////////////////////////////
+            // NOTE: can't use 'waiter' at this point in time //
+            // because it might have been deallocated!        //
+            ////////////////////////////////////////////////////
+          }
         });
   }
 
@@ -99,13 +217,12 @@ StaticThreadPool::StaticThreadPool()
 
 StaticThreadPool::~StaticThreadPool() {
   shutdown_.store(true);
-  while (!threads_.empty()) {
-    auto* semaphore = semaphores_.back();
-    semaphore->Signal();
-    semaphores_.pop_back();
-    auto& thread = threads_.back();
+  for (unsigned int cpu = 0; cpu < concurrency; cpu++) {
+    states_[cpu].semaphore.Signal();
+    WakePoller(cpu);
+  }
+  for (auto& thread : threads_) {
     thread.join();
-    threads_.pop_back();
   }
 }
 
@@ -119,11 +236,12 @@ void StaticThreadPool::Submit(Callback<void()> callback, Context* context) {
 
   auto* requirements =
       static_cast<StaticThreadPool::Requirements*>(context->data);
-  auto& pinned = requirements->pinned;
 
-  CHECK(pinned.cpu()) << context->name();
+  auto placed = requirements->cpu();
+
+  CHECK(placed) << context->name();
 
-  unsigned int cpu = pinned.cpu().value();
+  unsigned int cpu = placed.value();
 
   assert(cpu < concurrency);
 
@@ -131,19 +249,73 @@ void StaticThreadPool::Submit(Callback<void()> callback, Context* context) {
 
   context->callback = std::move(callback);
 
-  auto* head = heads_[cpu];
+  context->queue = cpu;
 
-  context->next = head->load(std::memory_order_relaxed);
+  states_[cpu].load.fetch_add(1, std::memory_order_relaxed);
 
-  while (!head->compare_exchange_weak(
-      context->next,
-      context,
-      std::memory_order_release,
-      std::memory_order_relaxed)) {}
+  queues_[cpu]->Push(context);
 
-  auto* semaphore = semaphores_[cpu];
+  // NOTE: this fence pairs with the one in 'Idle()' so that either
+  // we see that the thread has parked or it sees our context.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
 
-  semaphore->Signal();
+  Unpark(cpu);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+unsigned int StaticThreadPool::Place(Placement placement) {
+  switch (placement) {
+    case Placement::Current:
+      if (StaticThreadPool::member) {
+        return StaticThreadPool::cpu;
+      }
+      break;
+    case Placement::RoundRobin:
+      return next_.fetch_add(1, std::memory_order_relaxed) % concurrency;
+    case Placement::LeastLoaded:
+    case Placement::WorkStealing:
+      break;
+  }
+
+  // NOTE: we start looking at a different CPU each time so that
+  // concurrent placements that see the same loads (e.g., when all of
+  // the CPUs are idle) don't all pick the same CPU.
+  unsigned int start = next_.fetch_add(1, std::memory_order_relaxed);
+
+  unsigned int cpu = start % concurrency;
+  size_t load = Load(cpu);
+
+  for (unsigned int i = 1; i < concurrency && load > 0; i++) {
+    unsigned int candidate = (start + i) % concurrency;
+    size_t candidate_load = Load(candidate);
+    if (candidate_load < load) {
+      cpu = candidate;
+      load = candidate_load;
+    }
+  }
+
+  return cpu;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+unsigned int StaticThreadPool::Place(Requirements* requirements) {
+  unsigned int cpu = requirements->cpu_.load(std::memory_order_acquire);
+
+  if (cpu == Requirements::UNPLACED) {
+    unsigned int placed = Place(requirements->placement);
+    // NOTE: if we lose the race 'cpu' gets set to the winner's CPU.
+    if (requirements->cpu_.compare_exchange_strong(
+            cpu,
+            placed,
+            std::memory_order_acq_rel,
+            std::memory_order_acquire)) {
+      cpu = placed;
+    }
+  }
+
+  return cpu;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -154,13 +326,289 @@ bool StaticThreadPool::Continuable(Context* context) {
 
   auto* requirements =
       static_cast<StaticThreadPool::Requirements*>(context->data);
-  auto& pinned = requirements->pinned;
 
-  CHECK(pinned.cpu()) << context->name();
+  auto placed = requirements->cpu();
+
+  CHECK(placed) << context->name();
+
+  unsigned int cpu = placed.value();
+
+  return StaticThreadPool::member
+      && (StaticThreadPool::cpu == cpu || requirements->stealable);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+StaticThreadPool::Context* StaticThreadPool::Steal(unsigned int cpu) {
+  for (unsigned int i = 1; i < concurrency; i++) {
+    auto* context = deques_[(cpu + i) % concurrency]->Steal();
+    if (context != nullptr) {
+      stealable_.fetch_sub(1, std::memory_order_relaxed);
+      EVENTUALS_LOG(1)
+          << "CPU " << cpu << " stole '" << context->name() << "'";
+      return context;
+    }
+  }
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void StaticThreadPool::Wake(unsigned int cpu) {
+  // NOTE: any CPUs that are spinning (or yielding) will notice the
+  // contexts that can be stolen on their own.
+  for (unsigned int i = 1; i < concurrency; i++) {
+    if (Unpark((cpu + i) % concurrency)) {
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool StaticThreadPool::Unpark(unsigned int cpu) {
+  auto& state = states_[cpu];
+  auto status = Status::Parked;
+  if (state.status.load(std::memory_order_relaxed) == Status::Parked
+      && state.status.compare_exchange_strong(status, Status::Running)) {
+    state.wakeups.fetch_add(1, std::memory_order_relaxed);
+    state.semaphore.Signal();
+    // NOTE: the thread might be waiting on its poller rather than
+    // the semaphore, in which case it'll still consume the signal.
+    WakePoller(cpu);
+    return true;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void StaticThreadPool::Idle(unsigned int cpu, Queue& queue) {
+  auto& state = states_[cpu];
+
+  const auto spin = std::chrono::nanoseconds(
+      spin_.load(std::memory_order_relaxed));
+
+  const auto yield = spin
+      + std::chrono::nanoseconds(yield_.load(std::memory_order_relaxed));
+
+  if (yield > std::chrono::nanoseconds::zero()) {
+    state.status.store(Status::Spinning, std::memory_order_relaxed);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Number of times to pause between checks, doubled each time up
+    // to 'MAX_PAUSES' so that we don't keep hammering the cache lines
+    // of the queues (and deques) that other threads are writing to.
+    static constexpr size_t MAX_PAUSES = 64;
+
+    size_t pauses = 1;
+
+    do {
+      if (Ready(cpu, queue)
+          || Poll(cpu)
+          || shutdown_.load(std::memory_order_relaxed)) {
+        state.status.store(Status::Running, std::memory_order_relaxed);
+        state.spins.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+
+      if (std::chrono::steady_clock::now() - start < spin) {
+        for (size_t i = 0; i < pauses; i++) {
+          PauseCPU();
+        }
+        pauses = std::min(pauses * 2, MAX_PAUSES);
+      } else {
+        std::this_thread::yield();
+      }
+    } while (std::chrono::steady_clock::now() - start < yield);
+  }
+
+  state.status.store(Status::Parked, std::memory_order_relaxed);
+
+  // NOTE: this fence pairs with the one in 'Submit()' so that either
+  // we see the submitted context or the submitter sees that we've
+  // parked (and thus signals us).
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (Ready(cpu, queue)) {
+    auto status = Status::Parked;
+    if (state.status.compare_exchange_strong(status, Status::Running)) {
+      return;
+    }
+    // Someone has already transitioned us to running and has (or
+    // will) signal our semaphore, so we need to wait to consume the
+    // signal before we can continue.
+  }
+
+  state.parks.fetch_add(1, std::memory_order_relaxed);
+
+  // If we have a poller we wait for events (or to be woken up) rather
+  // than parking on our semaphore.
+  if (auto* poller = AcquirePoller(cpu); poller != nullptr) {
+    Context::Set(state.context);
+    poller->Wait();
+    ReleasePoller(cpu);
+
+    auto status = Status::Parked;
+    if (state.status.compare_exchange_strong(status, Status::Running)) {
+      return;
+    }
+    // Someone has already transitioned us to running and has (or
+    // will) signal our semaphore, so we need to wait to consume the
+    // signal before we can continue.
+  }
+
+  state.semaphore.Wait();
+
+  // NOTE: we might have been signalled because we're shutting down in
+  // which case our status is still 'Parked'.
+  state.status.store(Status::Running, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool StaticThreadPool::Ready(unsigned int cpu, Queue& queue) {
+  // NOTE: rather than check every other CPU's deque, which would
+  // touch a cache line per CPU every time we spin, we check the
+  // number of contexts that can be stolen from any deque.
+  return !queue.Empty()
+      || !deques_[cpu]->Empty()
+      || stealable_.load(std::memory_order_relaxed) > 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool StaticThreadPool::SetPoller(unsigned int cpu, Poller* poller) {
+  CHECK_LT(cpu, concurrency);
+  CHECK_NOTNULL(poller);
+
+  Poller* expected = nullptr;
+
+  if (!states_[cpu].poller.compare_exchange_strong(expected, poller)) {
+    return false;
+  }
+
+  // Make sure a parked thread starts using 'poller'.
+  Unpark(cpu);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void StaticThreadPool::RemovePoller(unsigned int cpu, Poller* poller) {
+  CHECK_LT(cpu, concurrency);
+  CHECK_NOTNULL(poller);
+
+  CHECK(!(StaticThreadPool::member && StaticThreadPool::cpu == cpu))
+      << "Can't remove the poller for CPU " << cpu << " from its own thread";
+
+  auto& state = states_[cpu];
 
-  unsigned int cpu = pinned.cpu().value();
+  Poller* expected = poller;
+
+  if (!state.poller.compare_exchange_strong(expected, nullptr)) {
+    return;
+  }
+
+  // Make sure the thread isn't (or won't be) waiting on 'poller' and
+  // then wait until neither the thread nor anyone waking it is still
+  // using 'poller'.
+  poller->Wake();
+
+  while (state.polling.load() == poller || state.waking.load() > 0) {
+    std::this_thread::yield();
+  }
+
+  // Make sure a thread that was waiting on 'poller' parks instead.
+  Unpark(cpu);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool StaticThreadPool::Poll(unsigned int cpu) {
+  auto* poller = AcquirePoller(cpu);
+
+  if (poller == nullptr) {
+    return false;
+  }
+
+  Context::Set(states_[cpu].context);
+
+  bool polled = poller->Poll();
+
+  ReleasePoller(cpu);
+
+  return polled;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+StaticThreadPool::Poller* StaticThreadPool::AcquirePoller(unsigned int cpu) {
+  auto& state = states_[cpu];
+
+  // Fast path for pools that never have a poller so that they don't
+  // pay for any of the fences below every time they look for work.
+  if (state.poller.load(std::memory_order_relaxed) == nullptr) {
+    return nullptr;
+  }
+
+  // NOTE: we publish the poller we're about to use and then check
+  // that it's still the current poller which pairs with the
+  // 'compare_exchange_strong()' and then 'load()' in 'RemovePoller()'
+  // so that either we see it was removed or 'RemovePoller()' sees us
+  // using it.
+  Poller* poller = state.poller.load();
+
+  while (poller != nullptr) {
+    state.polling.store(poller);
+
+    Poller* current = state.poller.load();
+
+    if (current == poller) {
+      return poller;
+    }
+
+    poller = current;
+  }
+
+  state.polling.store(nullptr);
+
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void StaticThreadPool::ReleasePoller(unsigned int cpu) {
+  states_[cpu].polling.store(nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void StaticThreadPool::WakePoller(unsigned int cpu) {
+  auto& state = states_[cpu];
+
+  // Fast path for pools that never have a poller, see 'AcquirePoller()'.
+  //
+  // NOTE: we can only miss a poller that is being set concurrently,
+  // in which case 'SetPoller()' unparks (and thus wakes) the thread
+  // itself after setting the poller.
+  if (state.poller.load(std::memory_order_relaxed) == nullptr) {
+    return;
+  }
+
+  // NOTE: like 'AcquirePoller()' we first publish that we might be
+  // using the poller so that 'RemovePoller()' waits for us.
+  state.waking.fetch_add(1);
+
+  auto* poller = state.poller.load();
+
+  if (poller != nullptr) {
+    poller->Wake();
+  }
 
-  return StaticThreadPool::member && StaticThreadPool::cpu == cpu;
+  state.waking.fetch_sub(1);
 }
 
 ////////////////////////////////////////////////////////////////////////
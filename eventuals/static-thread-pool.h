@@ -1,9 +1,13 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <deque>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <tuple>
 #include <vector>
@@ -52,18 +56,157 @@ struct Pinned {
 
 ////////////////////////////////////////////////////////////////////////
 
+// Policies for picking a CPU for requirements that are not pinned,
+// i.e., 'Pinned::Any()'. A CPU is only picked once, the first time
+// something gets scheduled with the requirements, after which the
+// requirements stay on that CPU, see 'Requirements::cpu()'.
+enum class Placement {
+  // Pick the CPU with the fewest contexts waiting to be resumed.
+  LeastLoaded,
+
+  // Cycle through all of the CPUs.
+  RoundRobin,
+
+  // Stay on the current CPU if the current thread is a member of the
+  // static thread pool, otherwise fall back to 'LeastLoaded'.
+  Current,
+
+  // Start on the least loaded CPU but let any other CPU that is idle
+  // steal contexts using these requirements. This means contexts
+  // using the same requirements may run on different CPUs, and thus
+  // in parallel, so only opt-in when that is safe!
+  WorkStealing,
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// What a thread in the static thread pool does when it runs out of
+// contexts to resume: first it spins (with an exponential backoff)
+// for 'spin', then it yields the CPU for 'yield', and only then does
+// it "park" by waiting to be signalled. Spinning and yielding trade
+// CPU time for lower latency when contexts get submitted in quick
+// succession since a thread that isn't parked doesn't need to be
+// signalled (which requires a system call).
+//
+// The default is to park immediately.
+struct IdlePolicy final {
+  std::chrono::nanoseconds spin = std::chrono::nanoseconds::zero();
+  std::chrono::nanoseconds yield = std::chrono::nanoseconds::zero();
+};
+
+////////////////////////////////////////////////////////////////////////
+
 class StaticThreadPool final : public Scheduler {
  public:
+  // Counters for what a thread has done while idle, see 'IdlePolicy'.
+  struct IdleStatistics final {
+    // Number of times the thread found a context to resume while
+    // spinning or yielding, i.e., without having to park.
+    size_t spins = 0;
+
+    // Number of times the thread parked.
+    size_t parks = 0;
+
+    // Number of times the thread was signalled to stop parking.
+    size_t wakeups = 0;
+  };
+
   struct Requirements final {
-    Requirements(const char* name, Pinned pinned = Pinned::Any())
-      : Requirements(std::string(name), std::move(pinned)) {}
+    // NOTE: doesn't copy 'name' so constructing (or copying)
+    // requirements doesn't allocate, see 'StaticName'.
+    Requirements(
+        StaticName name,
+        Pinned pinned = Pinned::Any(),
+        Placement placement = Placement::LeastLoaded)
+      : name(name.c_str()),
+        pinned(pinned),
+        placement(placement),
+        stealable(
+            !this->pinned.cpu() && placement == Placement::WorkStealing),
+        cpu_(this->pinned.cpu().value_or(UNPLACED)) {}
+
+    template <size_t N>
+    Requirements(
+        const char (&name)[N],
+        Pinned pinned = Pinned::Any(),
+        Placement placement = Placement::LeastLoaded)
+      : Requirements(StaticName(name), std::move(pinned), placement) {}
+
+    // NOTE: copies 'name' which might allocate.
+    Requirements(
+        std::string name,
+        Pinned pinned = Pinned::Any(),
+        Placement placement = Placement::LeastLoaded)
+      : owned_(std::move(name)),
+        name(owned_),
+        pinned(pinned),
+        placement(placement),
+        stealable(
+            !this->pinned.cpu() && placement == Placement::WorkStealing),
+        cpu_(this->pinned.cpu().value_or(UNPLACED)) {}
+
+    // A 'const char*' might not outlive the requirements, use a
+    // 'StaticName' or a 'std::string' instead.
+    template <
+        typename T,
+        std::enable_if_t<
+            std::is_same_v<T, const char*> || std::is_same_v<T, char*>,
+            int> = 0>
+    Requirements(
+        T name,
+        Pinned pinned = Pinned::Any(),
+        Placement placement = Placement::LeastLoaded) = delete;
+
+    Requirements(const Requirements& that)
+      : owned_(that.owned_),
+        name(
+            that.name.data() == that.owned_.data()
+                ? std::string_view(owned_)
+                : that.name),
+        pinned(that.pinned),
+        placement(that.placement),
+        stealable(that.stealable),
+        cpu_(that.cpu_.load(std::memory_order_acquire)) {}
+
+    // Returns the CPU these requirements were explicitly pinned to or
+    // else were placed on (see 'Placement'), if they've been placed.
+    std::optional<unsigned int> cpu() const {
+      unsigned int cpu = cpu_.load(std::memory_order_acquire);
+      if (cpu == UNPLACED) {
+        return std::nullopt;
+      } else {
+        return cpu;
+      }
+    }
 
-    Requirements(std::string name, Pinned pinned = Pinned::Any())
-      : name(std::move(name)),
-        pinned(pinned) {}
+   private:
+    // Storage for 'name' if it wasn't a 'StaticName'.
+    //
+    // NOTE: must be declared before 'name' since 'name' might refer
+    // to it.
+    std::string owned_;
 
-    std::string name;
+   public:
+    std::string_view name;
     Pinned pinned;
+    Placement placement;
+
+    // Whether or not contexts using these requirements can be stolen
+    // by other CPUs. NOTE: requirements that were explicitly pinned
+    // to a CPU are never stealable even if using
+    // 'Placement::WorkStealing'.
+    bool stealable;
+
+   private:
+    friend class StaticThreadPool;
+
+    static constexpr unsigned int UNPLACED =
+        std::numeric_limits<unsigned int>::max();
+
+    // NOTE: requirements are shared by everything that gets scheduled
+    // with them, possibly from many threads at once, so the CPU gets
+    // published exactly once via a CAS, see 'StaticThreadPool::Place()'.
+    std::atomic<unsigned int> cpu_;
   };
 
   class Schedulable {
@@ -90,6 +233,28 @@ class StaticThreadPool final : public Scheduler {
     Requirements requirements_;
   };
 
+  // Lets the thread of a CPU handle events from some other source,
+  // e.g., a gRPC completion queue, in between resuming contexts, and
+  // wait for those events instead of parking when it is idle. This
+  // way an event and any contexts it resumes get handled on the same
+  // CPU, in one step, without a hop through another thread.
+  class Poller {
+   public:
+    virtual ~Poller() = default;
+
+    // Handles any events that are ready without blocking and returns
+    // whether or not any events were handled.
+    virtual bool Poll() = 0;
+
+    // Blocks until at least one event has been handled or until
+    // 'Wake()' has been called.
+    virtual void Wait() = 0;
+
+    // Causes a current (or the next) call to 'Wait()' to return. Can
+    // be called from any thread.
+    virtual void Wake() = 0;
+  };
+
   static StaticThreadPool& Scheduler() {
     static StaticThreadPool pool;
     return pool;
@@ -122,15 +287,150 @@ class StaticThreadPool final : public Scheduler {
   template <typename E>
   static auto Spawn(Requirements&& requirements, E e);
 
+  // Returns the CPU to use for requirements that are not pinned
+  // based on the specified placement policy.
+  unsigned int Place(Placement placement);
+
+  // Returns the CPU for the specified requirements, placing them
+  // first if they aren't pinned and haven't already been placed. If
+  // multiple threads race to place the same requirements they all
+  // get back the same CPU.
+  unsigned int Place(Requirements* requirements);
+
+  // Returns the number of contexts that have been submitted to the
+  // specified CPU but not yet resumed.
+  size_t Load(unsigned int cpu) {
+    return states_[cpu].load.load(std::memory_order_relaxed);
+  }
+
+  // Sets the policy for what threads do when they are idle. Can be
+  // called at any time, threads use the new policy the next time
+  // they become idle.
+  void SetIdlePolicy(const IdlePolicy& policy) {
+    spin_.store(policy.spin.count(), std::memory_order_relaxed);
+    yield_.store(policy.yield.count(), std::memory_order_relaxed);
+  }
+
+  // Sets the poller for the specified CPU, see 'Poller', unless the
+  // CPU already has a poller in which case returns false, i.e., a CPU
+  // has at most one poller and it never gets replaced.
+  bool SetPoller(unsigned int cpu, Poller* poller);
+
+  // Removes 'poller' from the specified CPU if it is (still) the
+  // poller for that CPU. Returns once the thread for the CPU is no
+  // longer using 'poller' so that it can be destructed.
+  //
+  // NOTE: must not be called from the thread of the specified CPU.
+  void RemovePoller(unsigned int cpu, Poller* poller);
+
+  // Returns the idle statistics for the specified CPU.
+  IdleStatistics Statistics(unsigned int cpu) {
+    auto& state = states_[cpu];
+    IdleStatistics statistics;
+    statistics.spins = state.spins.load(std::memory_order_relaxed);
+    statistics.parks = state.parks.load(std::memory_order_relaxed);
+    statistics.wakeups = state.wakeups.load(std::memory_order_relaxed);
+    return statistics;
+  }
+
  private:
-  // NOTE: we use a semaphore instead of something like eventfd for
-  // "signalling" the thread because it should be faster/less overhead
-  // in the kernel: https://stackoverflow.com/q/9826919
-  std::vector<Semaphore*> semaphores_;
-  std::vector<std::atomic<Context*>*> heads_;
+  // Chase-Lev deque used for holding contexts that can be stolen.
+  class Deque;
+
+  // Returns a context stolen from any CPU other than the specified
+  // one or nullptr if there weren't any contexts to steal.
+  Context* Steal(unsigned int cpu);
+
+  // Wakes up a CPU other than the specified one that is parked so
+  // that it can try and steal a context.
+  void Wake(unsigned int cpu);
+
+  // Signals the specified CPU if (and only if) it is parked.
+  bool Unpark(unsigned int cpu);
+
+  // Returns once the specified CPU (i.e., the calling thread) might
+  // have a context to resume, following the current 'IdlePolicy'.
+  void Idle(unsigned int cpu, Queue& queue);
+
+  // Whether or not there might be a context for the specified CPU to
+  // resume or steal.
+  bool Ready(unsigned int cpu, Queue& queue);
+
+  // Handles any events that are ready from the poller for the
+  // specified CPU (i.e., the calling thread), if any, and returns
+  // whether or not any events were handled.
+  bool Poll(unsigned int cpu);
+
+  // Returns the poller for the specified CPU (i.e., the calling
+  // thread), if any, which must be released via 'ReleasePoller()'.
+  Poller* AcquirePoller(unsigned int cpu);
+
+  void ReleasePoller(unsigned int cpu);
+
+  // Wakes the poller for the specified CPU, if any.
+  void WakePoller(unsigned int cpu);
+
+  // Possible values of 'State::status'.
+  enum class Status {
+    Running,
+    Spinning,
+    Parked,
+  };
+
+  // Per CPU state that gets accessed by the submitting threads as
+  // well as the thread for the CPU, hence each gets its own cache
+  // line to avoid false sharing.
+  struct alignas(64) State final {
+    // NOTE: we use a semaphore instead of something like eventfd for
+    // "signalling" the thread because it should be faster/less
+    // overhead in the kernel: https://stackoverflow.com/q/9826919
+    Semaphore semaphore;
+
+    // Number of contexts that have been submitted but not yet resumed.
+    std::atomic<size_t> load = 0;
+
+    // Whether the thread is running, spinning (or yielding), or
+    // parked, i.e., waiting on 'semaphore'. The semaphore only gets
+    // signalled by whoever transitions the thread from parked to
+    // running so submitting a context to a thread that is not
+    // parked is just a push onto its queue.
+    std::atomic<Status> status = Status::Running;
+
+    // See 'Poller'. The thread sets 'polling' to the poller it might
+    // be using and other threads increment 'waking' while they
+    // might be calling 'Poller::Wake()' so that 'RemovePoller()' can
+    // wait until neither could still be using a previous poller.
+    std::atomic<Poller*> poller = nullptr;
+    std::atomic<Poller*> polling = nullptr;
+    std::atomic<size_t> waking = 0;
+
+    // The thread's own context which gets used while handling events
+    // from 'poller' rather than whatever context was last resumed.
+    Context* context = nullptr;
+
+    // See 'IdleStatistics'.
+    std::atomic<size_t> spins = 0;
+    std::atomic<size_t> parks = 0;
+    std::atomic<size_t> wakeups = 0;
+  };
+
+  std::vector<State> states_;
+  std::vector<std::unique_ptr<Deque>> deques_;
+  std::vector<Queue*> queues_;
   std::deque<Semaphore> ready_;
   std::vector<std::thread> threads_;
   std::atomic<bool> shutdown_ = false;
+
+  std::atomic<unsigned int> next_ = 0;
+
+  // Number of contexts across all of the deques that can be stolen,
+  // see 'Ready()'. Gets its own cache line since it's written every
+  // time a context gets pushed onto or taken from a deque.
+  alignas(64) std::atomic<size_t> stealable_ = 0;
+
+  // See 'IdlePolicy', stored as nanoseconds.
+  std::atomic<int64_t> spin_ = 0;
+  std::atomic<int64_t> yield_ = 0;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -174,24 +474,21 @@ struct _StaticThreadPoolSchedule final {
 
       EVENTUALS_LOG(1) << "Scheduling '" << context_->name() << "'";
 
-      auto& pinned = requirements()->pinned;
-
-      if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::ExactCPU(0);
-      }
+      unsigned int cpu = pool()->Place(requirements());
 
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(cpu, pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member
+          && (StaticThreadPool::cpu == cpu
+              || requirements()->stealable)) {
         Adapt();
-        auto* previous = Scheduler::Context::Switch(context_.get());
+        // NOTE: can't use 'context_' after continuing because we
+        // might have been deallocated!
+        auto* context = context_.get();
+        auto* previous = Scheduler::Context::Switch(context);
         adapted_->Start(std::forward<Args>(args)...);
         previous = Scheduler::Context::Switch(previous);
-        CHECK_EQ(previous, context_.get());
+        CHECK_EQ(previous, context);
       } else {
         if constexpr (!std::is_void_v<Arg_>) {
           arg_.emplace(std::forward<Args>(args)...);
@@ -222,45 +519,31 @@ struct _StaticThreadPoolSchedule final {
 
       EVENTUALS_LOG(1) << "Scheduling '" << context_->name() << "'";
 
-      auto& pinned = requirements()->pinned;
+      unsigned int cpu = pool()->Place(requirements());
 
-      if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::ExactCPU(0);
-      }
-
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(cpu, pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member
+          && (StaticThreadPool::cpu == cpu
+              || requirements()->stealable)) {
         Adapt();
-        auto* previous = Scheduler::Context::Switch(context_.get());
+        // NOTE: can't use 'context_' after continuing because we
+        // might have been deallocated!
+        auto* context = context_.get();
+        auto* previous = Scheduler::Context::Switch(context);
         adapted_->Fail(std::forward<Error>(error));
         previous = Scheduler::Context::Switch(previous);
-        CHECK_EQ(previous, context_.get());
+        CHECK_EQ(previous, context);
       } else {
-        // TODO(benh): avoid allocating on heap by storing args in
-        // pre-allocated buffer based on composing with Errors.
-        using Tuple = std::tuple<decltype(this), Error>;
-        auto tuple = std::make_unique<Tuple>(
-            this,
-            std::forward<Error>(error));
-
         EVENTUALS_LOG(1)
             << "Schedule submitting '" << context_->name() << "'";
 
         pool()->Submit(
-            this->Borrow([tuple = std::move(tuple)]() mutable {
-              std::apply(
-                  [](auto* schedule, auto&&... args) {
-                    schedule->Adapt();
-                    schedule->adapted_->Fail(
-                        std::forward<decltype(args)>(args)...);
-                  },
-                  std::move(*tuple));
-            }),
+            Pooled(this->Borrow(
+                [this, error = std::forward<Error>(error)]() mutable {
+                  Adapt();
+                  adapted_->Fail(std::move(error));
+                })),
             context_.get());
       }
     }
@@ -273,24 +556,21 @@ struct _StaticThreadPoolSchedule final {
 
       EVENTUALS_LOG(1) << "Scheduling '" << context_->name() << "'";
 
-      auto& pinned = requirements()->pinned;
+      unsigned int cpu = pool()->Place(requirements());
 
-      if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::ExactCPU(0);
-      }
-
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(cpu, pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member
+          && (StaticThreadPool::cpu == cpu
+              || requirements()->stealable)) {
         Adapt();
-        auto* previous = Scheduler::Context::Switch(context_.get());
+        // NOTE: can't use 'context_' after continuing because we
+        // might have been deallocated!
+        auto* context = context_.get();
+        auto* previous = Scheduler::Context::Switch(context);
         adapted_->Stop();
         previous = Scheduler::Context::Switch(previous);
-        CHECK_EQ(previous, context_.get());
+        CHECK_EQ(previous, context);
       } else {
         EVENTUALS_LOG(1)
             << "Schedule submitting '" << context_->name() << "'";
@@ -310,24 +590,21 @@ struct _StaticThreadPoolSchedule final {
 
       EVENTUALS_LOG(1) << "Scheduling '" << context_->name() << "'";
 
-      auto& pinned = requirements()->pinned;
-
-      if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::ExactCPU(0);
-      }
+      unsigned int cpu = pool()->Place(requirements());
 
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(cpu, pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member
+          && (StaticThreadPool::cpu == cpu
+              || requirements()->stealable)) {
         Adapt();
-        auto* previous = Scheduler::Context::Switch(context_.get());
+        // NOTE: can't use 'context_' after continuing because we
+        // might have been deallocated!
+        auto* context = context_.get();
+        auto* previous = Scheduler::Context::Switch(context);
         adapted_->Begin(*CHECK_NOTNULL(stream_));
         previous = Scheduler::Context::Switch(previous);
-        CHECK_EQ(previous, context_.get());
+        CHECK_EQ(previous, context);
       } else {
         EVENTUALS_LOG(1)
             << "Schedule submitting '" << context_->name() << "'";
@@ -349,24 +626,21 @@ struct _StaticThreadPoolSchedule final {
 
       EVENTUALS_LOG(1) << "Scheduling '" << context_->name() << "'";
 
-      auto& pinned = requirements()->pinned;
+      unsigned int cpu = pool()->Place(requirements());
 
-      if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::ExactCPU(0);
-      }
-
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(cpu, pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member
+          && (StaticThreadPool::cpu == cpu
+              || requirements()->stealable)) {
         Adapt();
-        auto* previous = Scheduler::Context::Switch(context_.get());
+        // NOTE: can't use 'context_' after continuing because we
+        // might have been deallocated!
+        auto* context = context_.get();
+        auto* previous = Scheduler::Context::Switch(context);
         adapted_->Body(std::forward<Args>(args)...);
         previous = Scheduler::Context::Switch(previous);
-        CHECK_EQ(previous, context_.get());
+        CHECK_EQ(previous, context);
       } else {
         if constexpr (!std::is_void_v<Arg_>) {
           arg_.emplace(std::forward<Args>(args)...);
@@ -396,24 +670,21 @@ struct _StaticThreadPoolSchedule final {
 
       EVENTUALS_LOG(1) << "Scheduling '" << context_->name() << "'";
 
-      auto& pinned = requirements()->pinned;
-
-      if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::ExactCPU(0);
-      }
+      unsigned int cpu = pool()->Place(requirements());
 
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(cpu, pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member
+          && (StaticThreadPool::cpu == cpu
+              || requirements()->stealable)) {
         Adapt();
-        auto* previous = Scheduler::Context::Switch(context_.get());
+        // NOTE: can't use 'context_' after continuing because we
+        // might have been deallocated!
+        auto* context = context_.get();
+        auto* previous = Scheduler::Context::Switch(context);
         adapted_->Ended();
         previous = Scheduler::Context::Switch(previous);
-        CHECK_EQ(previous, context_.get());
+        CHECK_EQ(previous, context);
       } else {
         EVENTUALS_LOG(1)
             << "Schedule submitting '" << context_->name() << "'";
@@ -74,20 +74,10 @@ struct _Stream final {
             k_->Fail(std::forward<Error>(error));
           },
           [&]() {
-            // TODO(benh): avoid allocating on heap by storing args in
-            // pre-allocated buffer based on composing with Errors.
-            using Tuple = std::tuple<decltype(k_), Error>;
-            auto tuple = std::make_unique<Tuple>(
-                k_,
-                std::forward<Error>(error));
-
-            return [tuple = std::move(tuple)]() mutable {
-              std::apply(
-                  [](auto* k_, auto&&... args) {
-                    k_->Fail(std::forward<decltype(args)>(args)...);
-                  },
-                  std::move(*tuple));
-            };
+            return Pooled(
+                [k = k_, error = std::forward<Error>(error)]() mutable {
+                  k->Fail(std::move(error));
+                });
           });
     }
 
@@ -14,3 +14,34 @@ TEST_F(EventualsGrpcTest, BuildAndStart) {
   ASSERT_TRUE(build.status.ok());
   ASSERT_TRUE(build.server);
 }
+
+TEST_F(EventualsGrpcTest, BuildAndStartOutstandingRequests) {
+  ServerBuilder builder;
+
+  builder.SetNumberOfCompletionQueues(2);
+  builder.SetOutstandingRequestsPerCompletionQueue(4);
+
+  builder.AddListeningPort("0.0.0.0:0", grpc::InsecureServerCredentials());
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+  ASSERT_TRUE(build.server);
+}
+
+TEST_F(EventualsGrpcTest, BuildAndStartOutstandingRequestsError) {
+  ServerBuilder builder;
+
+  builder.SetOutstandingRequestsPerCompletionQueue(0);
+
+  builder.AddListeningPort("0.0.0.0:0", grpc::InsecureServerCredentials());
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_FALSE(build.status.ok());
+  EXPECT_EQ(
+      "Error building server: "
+      "outstanding requests per completion queue must be positive",
+      build.status.error());
+  EXPECT_FALSE(build.server);
+}
@@ -1,5 +1,8 @@
 #include "eventuals/callback.h"
 
+#include <array>
+#include <string>
+
 #include "gtest/gtest.h"
 #include "stout/borrowed_ptr.h"
 
@@ -64,3 +67,36 @@ TEST(Callback, BorrowedCallable) {
 
   EXPECT_EQ(foo.borrows(), 0);
 }
+
+TEST(Callback, Size) {
+  std::array<int, 8> array = {1, 2, 3, 4, 5, 6, 7, 8};
+
+  Callback<int(), sizeof(array)> callback = [array]() {
+    return array[7];
+  };
+
+  EXPECT_EQ(8, callback());
+}
+
+TEST(Callback, Pooled) {
+  std::string s(100, 'x');
+
+  // Small enough to be stored inline.
+  Callback<size_t()> small = eventuals::Pooled([&s]() {
+    return s.size();
+  });
+
+  EXPECT_EQ(100, small());
+
+  // Too big to be stored inline, uses the pool.
+  for (size_t i = 0; i < 3; i++) {
+    Callback<size_t()> big = eventuals::Pooled([s, i]() {
+      return s.size() + i;
+    });
+
+    Callback<size_t()> moved = std::move(big);
+
+    EXPECT_FALSE(big);
+    EXPECT_EQ(100 + i, moved());
+  }
+}
@@ -0,0 +1,143 @@
+#include "eventuals/channel.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "eventuals/collect.h"
+#include "eventuals/terminal.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using eventuals::Channel;
+using eventuals::ChannelOverflow;
+using eventuals::Collect;
+
+using testing::ElementsAre;
+
+TEST(Channel, Values) {
+  Channel<int> channel(8);
+
+  std::thread t([&channel]() {
+    for (int i = 1; i <= 5; ++i) {
+      EXPECT_FALSE(*channel.Write(int(i)));
+    }
+    *channel.Close();
+  });
+
+  auto e = [&channel]() {
+    return channel.Read()
+        | Collect<std::vector<int>>();
+  };
+
+  EXPECT_THAT(*e(), ElementsAre(1, 2, 3, 4, 5));
+
+  t.join();
+}
+
+
+TEST(Channel, Close) {
+  Channel<int> channel(8);
+
+  *channel.Write(1);
+  *channel.Write(2);
+  *channel.Close();
+  *channel.Write(3);
+
+  auto e = [&channel]() {
+    return channel.Read()
+        | Collect<std::vector<int>>();
+  };
+
+  EXPECT_THAT(*e(), ElementsAre(1, 2));
+}
+
+
+TEST(Channel, MoveOnly) {
+  Channel<std::unique_ptr<std::string>> channel(2);
+
+  *channel.Write(std::make_unique<std::string>("Hello"));
+  *channel.Write(std::make_unique<std::string>(" world!"));
+  *channel.Close();
+
+  auto e = [&channel]() {
+    return channel.Read()
+        | Collect<std::vector<std::unique_ptr<std::string>>>();
+  };
+
+  auto values = *e();
+
+  ASSERT_EQ(2, values.size());
+  EXPECT_EQ("Hello", *values[0]);
+  EXPECT_EQ(" world!", *values[1]);
+}
+
+
+TEST(Channel, Reject) {
+  Channel<int> channel(2, ChannelOverflow::Reject);
+
+  EXPECT_EQ(2, channel.capacity());
+
+  EXPECT_FALSE(*channel.Write(1));
+  EXPECT_FALSE(*channel.Write(2));
+  EXPECT_EQ(3, *channel.Write(3));
+
+  *channel.Close();
+
+  auto e = [&channel]() {
+    return channel.Read()
+        | Collect<std::vector<int>>();
+  };
+
+  EXPECT_THAT(*e(), ElementsAre(1, 2));
+}
+
+
+TEST(Channel, Spill) {
+  Channel<int> channel(2, ChannelOverflow::Spill);
+
+  EXPECT_EQ(2, channel.capacity());
+
+  // Writes more values than the capacity without any readers so
+  // values have to be spilled.
+  for (int i = 1; i <= 10; ++i) {
+    EXPECT_FALSE(*channel.Write(int(i)));
+  }
+
+  *channel.Close();
+
+  auto e = [&channel]() {
+    return channel.Read()
+        | Collect<std::vector<int>>();
+  };
+
+  EXPECT_THAT(*e(), ElementsAre(1, 2, 3, 4, 5, 6, 7, 8, 9, 10));
+}
+
+
+TEST(Channel, Block) {
+  Channel<int> channel(2);
+
+  // Writes more values than the capacity so writers have to wait for
+  // the reader.
+  std::thread t([&channel]() {
+    for (int i = 1; i <= 100; ++i) {
+      EXPECT_FALSE(*channel.Write(int(i)));
+    }
+    *channel.Close();
+  });
+
+  auto e = [&channel]() {
+    return channel.Read()
+        | Collect<std::vector<int>>();
+  };
+
+  auto values = *e();
+
+  t.join();
+
+  ASSERT_EQ(100, values.size());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i + 1, values[i]);
+  }
+}
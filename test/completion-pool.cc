@@ -0,0 +1,156 @@
+#include "eventuals/grpc/completion-pool.h"
+
+#include <thread>
+
+#include "eventuals/grpc/client.h"
+#include "eventuals/grpc/server.h"
+#include "eventuals/head.h"
+#include "eventuals/let.h"
+#include "eventuals/loop.h"
+#include "eventuals/map.h"
+#include "eventuals/static-thread-pool.h"
+#include "eventuals/terminal.h"
+#include "eventuals/then.h"
+#include "examples/protos/helloworld.grpc.pb.h"
+#include "gtest/gtest.h"
+
+using helloworld::Greeter;
+using helloworld::HelloReply;
+using helloworld::HelloRequest;
+
+using stout::Borrowable;
+
+using eventuals::Head;
+using eventuals::Let;
+using eventuals::Loop;
+using eventuals::Map;
+using eventuals::Pinned;
+using eventuals::StaticThreadPool;
+using eventuals::Terminate;
+using eventuals::Then;
+
+using eventuals::grpc::Client;
+using eventuals::grpc::CompletionPool;
+using eventuals::grpc::ServerBuilder;
+
+TEST(CompletionPoolTest, Current) {
+  CompletionPool pool(CompletionPool::Placement::Current, /* pin = */ true);
+
+  // Returns the completion queue scheduled from 'cpu'.
+  auto schedule = [&](unsigned int cpu) {
+    StaticThreadPool::Requirements requirements(
+        "completion-pool",
+        Pinned::ExactCPU(cpu));
+
+    return *StaticThreadPool::Scheduler().Schedule(
+        &requirements,
+        Then([&]() {
+          return pool.Schedule().get();
+        }));
+  };
+
+  auto* cq = schedule(0);
+
+  EXPECT_EQ(cq, schedule(0));
+
+  if (std::thread::hardware_concurrency() > 1) {
+    EXPECT_NE(cq, schedule(1));
+  }
+}
+
+
+TEST(CompletionPoolTest, RoundRobin) {
+  if (std::thread::hardware_concurrency() == 1) {
+    GTEST_SKIP() << "Need more than one CPU";
+  }
+
+  CompletionPool pool(CompletionPool::Placement::RoundRobin);
+
+  auto cq = pool.Schedule();
+
+  EXPECT_NE(cq.get(), pool.Schedule().get());
+}
+
+
+TEST(CompletionPoolTest, Polling) {
+  ServerBuilder builder;
+
+  int port = 0;
+
+  builder.AddListeningPort(
+      "0.0.0.0:0",
+      grpc::InsecureServerCredentials(),
+      &port);
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+
+  auto server = std::move(build.server);
+
+  ASSERT_TRUE(server);
+
+  auto serve = [&]() {
+    return server->Accept<Greeter, HelloRequest, HelloReply>("SayHello")
+        | Head()
+        | Then(Let([](auto& call) {
+             return UnaryPrologue(call)
+                 | Then([](auto&& request) {
+                      HelloReply reply;
+                      std::string prefix("Hello ");
+                      reply.set_message(prefix + request.name());
+                      return reply;
+                    })
+                 | UnaryEpilogue(call);
+           }));
+  };
+
+  auto [cancelled, k] = Terminate(serve());
+
+  k.Start();
+
+  // Completions get handled by the threads of the static thread pool.
+  Borrowable<CompletionPool> pool(StaticThreadPool::Scheduler());
+
+  Client client(
+      "0.0.0.0:" + std::to_string(port),
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  StaticThreadPool::Requirements requirements(
+      "completion-pool",
+      Pinned::ExactCPU(0));
+
+  auto call = [&]() {
+    return StaticThreadPool::Scheduler().Schedule(
+        &requirements,
+        client.Call<Greeter, HelloRequest, HelloReply>("SayHello")
+            | Then(Let([](auto& call) {
+                 HelloRequest request;
+                 request.set_name("emily");
+                 return call.Writer().WriteLast(request)
+                     | call.Reader().Read()
+                     | Map([](auto&& response) {
+                          EXPECT_EQ("Hello emily", response.message());
+
+                          // The response should have been handled by
+                          // the thread for the CPU that made the call.
+                          EXPECT_TRUE(StaticThreadPool::member);
+                          EXPECT_EQ(0, StaticThreadPool::cpu);
+                        })
+                     | Loop()
+                     | call.Finish();
+               })));
+  };
+
+  auto status = *call();
+
+  EXPECT_TRUE(status.ok());
+
+  // The completions of the call must have been handled by the threads
+  // of the static thread pool themselves rather than being handed off
+  // from another thread (which would also have ended up on CPU 0).
+  EXPECT_GT(pool.get()->polled(), 0);
+
+  EXPECT_FALSE(cancelled.get());
+}
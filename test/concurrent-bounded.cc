@@ -0,0 +1,138 @@
+#include <deque>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "eventuals/callback.h"
+#include "eventuals/collect.h"
+#include "eventuals/eventual.h"
+#include "eventuals/iterate.h"
+#include "eventuals/let.h"
+#include "eventuals/map.h"
+#include "eventuals/terminal.h"
+#include "test/concurrent.h"
+
+using eventuals::Callback;
+using eventuals::Collect;
+using eventuals::Eventual;
+using eventuals::Iterate;
+using eventuals::Let;
+using eventuals::Map;
+using eventuals::Terminate;
+
+// Tests that no more than 'n' fibers are active at a time.
+TYPED_TEST(ConcurrentTypedTest, Bounded) {
+  std::deque<Callback<void()>> callbacks;
+
+  auto e = [&]() {
+    return Iterate({1, 2, 3, 4, 5})
+        | this->ConcurrentOrConcurrentOrdered(2, [&]() {
+            struct Data {
+              void* k;
+              int i;
+            };
+            return Map(Let([&](int& i) {
+              return Eventual<std::string>(
+                  [&, data = Data()](auto& k) mutable {
+                    using K = std::decay_t<decltype(k)>;
+                    data.k = &k;
+                    data.i = i;
+                    callbacks.emplace_back([&data]() {
+                      static_cast<K*>(data.k)->Start(std::to_string(data.i));
+                    });
+                  });
+            }));
+          })
+        | Collect<std::vector<std::string>>();
+  };
+
+  auto [future, k] = Terminate(e());
+
+  k.Start();
+
+  // Only the first 2 fibers should have been started and each time
+  // one of them completes another one should get started.
+  //
+  // NOTE: completing the fibers in order since 'ConcurrentOrdered(n, f)'
+  // won't start another fiber when a fiber completes out of order,
+  // see 'ConcurrentOrderedTest.ReorderWindowBounded'.
+  for (size_t remaining = 5; remaining > 0; remaining--) {
+    ASSERT_EQ(std::min<size_t>(remaining, 2), callbacks.size());
+
+    EXPECT_EQ(
+        std::future_status::timeout,
+        future.wait_for(std::chrono::seconds(0)));
+
+    Callback<void()> callback = std::move(callbacks.front());
+    callbacks.pop_front();
+    callback();
+  }
+
+  EXPECT_TRUE(callbacks.empty());
+
+  EXPECT_THAT(
+      future.get(),
+      this->OrderedOrUnorderedElementsAre("1", "2", "3", "4", "5"));
+}
+
+// Tests that we stop requesting upstream values once 'n' values are
+// buffered waiting for downstream.
+TYPED_TEST(ConcurrentTypedTest, BoundedBackpressure) {
+  std::vector<int> values(100);
+  std::iota(values.begin(), values.end(), 1);
+
+  size_t requested = 0;
+
+  std::deque<Callback<void()>> callbacks;
+
+  auto e = [&]() {
+    return Iterate(std::move(values))
+        | Map([&](int i) {
+             requested++;
+             return i;
+           })
+        | this->ConcurrentOrConcurrentOrdered(2, []() {
+            return Map([](int i) {
+              return std::to_string(i);
+            });
+          })
+        // Downstream only takes the next value once the callback for
+        // the previous value has been invoked.
+        | Map(Let([&](std::string& s) {
+            struct Data {
+              void* k;
+              std::string* s;
+            };
+            return Eventual<std::string>(
+                [&, data = Data()](auto& k) mutable {
+                  using K = std::decay_t<decltype(k)>;
+                  data.k = &k;
+                  data.s = &s;
+                  callbacks.emplace_back([&data]() {
+                    static_cast<K*>(data.k)->Start(std::move(*data.s));
+                  });
+                });
+          }))
+        | Collect<std::vector<std::string>>();
+  };
+
+  auto [future, k] = Terminate(e());
+
+  k.Start();
+
+  // Downstream hasn't taken the first value yet so only a handful of
+  // values should have been requested from upstream rather than all
+  // of them.
+  ASSERT_EQ(1, callbacks.size());
+  EXPECT_LT(requested, 10);
+
+  while (!callbacks.empty()) {
+    Callback<void()> callback = std::move(callbacks.front());
+    callbacks.pop_front();
+    callback();
+  }
+
+  EXPECT_EQ(100, requested);
+
+  EXPECT_EQ(100, future.get().size());
+}
@@ -0,0 +1,134 @@
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "eventuals/callback.h"
+#include "eventuals/collect.h"
+#include "eventuals/concurrent-ordered.h"
+#include "eventuals/eventual.h"
+#include "eventuals/let.h"
+#include "eventuals/map.h"
+#include "eventuals/range.h"
+#include "eventuals/terminal.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using eventuals::Callback;
+using eventuals::Collect;
+using eventuals::ConcurrentOrdered;
+using eventuals::Eventual;
+using eventuals::Let;
+using eventuals::Map;
+using eventuals::Range;
+using eventuals::Terminate;
+
+// Tests that values get reordered even when there are more values
+// out of order than fit in the initial reorder window.
+TEST(ConcurrentOrderedTest, ReorderWindowGrows) {
+  std::deque<Callback<void()>> callbacks;
+
+  auto e = [&]() {
+    return Range(100)
+        | ConcurrentOrdered([&]() {
+             struct Data {
+               void* k;
+               int i;
+             };
+             return Map(Let([&](int& i) {
+               return Eventual<int>(
+                   [&, data = Data()](auto& k) mutable {
+                     using K = std::decay_t<decltype(k)>;
+                     data.k = &k;
+                     data.i = i;
+                     callbacks.emplace_back([&data]() {
+                       static_cast<K*>(data.k)->Start(data.i);
+                     });
+                   });
+             }));
+           })
+        | Collect<std::vector<int>>();
+  };
+
+  auto [future, k] = Terminate(e());
+
+  k.Start();
+
+  ASSERT_EQ(100, callbacks.size());
+
+  // Complete the fibers in reverse order so every value but the
+  // first one has to be buffered.
+  while (!callbacks.empty()) {
+    Callback<void()> callback = std::move(callbacks.back());
+    callbacks.pop_back();
+    callback();
+  }
+
+  std::vector<int> expected;
+  for (int i = 0; i < 100; i++) {
+    expected.push_back(i);
+  }
+
+  EXPECT_EQ(expected, future.get());
+}
+
+// Tests that no more than 'n' values get buffered waiting for a fiber
+// that is slow to emit its value, i.e., that we don't start fibers
+// for values too far past the next value to be emitted in order.
+TEST(ConcurrentOrderedTest, ReorderWindowBounded) {
+  std::deque<Callback<void()>> callbacks;
+
+  size_t completed = 0;
+  size_t received = 0;
+
+  auto e = [&]() {
+    return Range(100)
+        | ConcurrentOrdered(4, [&]() {
+             struct Data {
+               void* k;
+               int i;
+             };
+             return Map(Let([&](int& i) {
+               return Eventual<int>(
+                   [&, data = Data()](auto& k) mutable {
+                     using K = std::decay_t<decltype(k)>;
+                     data.k = &k;
+                     data.i = i;
+                     callbacks.emplace_back([&data]() {
+                       static_cast<K*>(data.k)->Start(data.i);
+                     });
+                   });
+             }));
+           })
+        | Map([&](int i) {
+             received++;
+             return i;
+           })
+        | Collect<std::vector<int>>();
+  };
+
+  auto [future, k] = Terminate(e());
+
+  k.Start();
+
+  ASSERT_EQ(4, callbacks.size());
+
+  // Always complete the most recently started fiber so that every
+  // value but the oldest has to be buffered.
+  while (!callbacks.empty()) {
+    ASSERT_LE(callbacks.size(), 4);
+
+    Callback<void()> callback = std::move(callbacks.back());
+    callbacks.pop_back();
+    completed++;
+    callback();
+
+    EXPECT_LE(completed - received, 4);
+  }
+
+  std::vector<int> expected;
+  for (int i = 0; i < 100; i++) {
+    expected.push_back(i);
+  }
+
+  EXPECT_EQ(expected, future.get());
+}
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eventuals/collect.h"
+#include "eventuals/iterate.h"
+#include "eventuals/map.h"
+#include "eventuals/static-thread-pool.h"
+#include "eventuals/terminal.h"
+#include "test/concurrent.h"
+
+using eventuals::Collect;
+using eventuals::Iterate;
+using eventuals::Map;
+using eventuals::StaticThreadPool;
+using eventuals::Terminate;
+
+// Tests that each fiber runs on a thread of the static thread pool
+// and that the fibers get spread across the CPUs of the pool.
+TYPED_TEST(ConcurrentTypedTest, Parallel) {
+  std::mutex mutex;
+  std::set<std::thread::id> ids;
+  std::set<unsigned int> cpus;
+
+  std::atomic<size_t> started = 0;
+
+  auto e = [&]() {
+    return Iterate({1, 2, 3, 4, 5})
+        | this->ParallelConcurrentOrParallelConcurrentOrdered(
+            StaticThreadPool::Scheduler(),
+            [&]() {
+              return Map([&](int i) {
+                EXPECT_TRUE(StaticThreadPool::member);
+
+                // Wait (for a bounded amount of time) until another
+                // fiber has started so that the fibers are running at
+                // the same time, otherwise a fiber might complete
+                // before the next one gets placed and every fiber
+                // could correctly be placed on the same CPU.
+                started.fetch_add(1);
+
+                auto deadline = std::chrono::steady_clock::now()
+                    + std::chrono::seconds(1);
+
+                while (started.load() < 2
+                       && std::chrono::steady_clock::now() < deadline) {
+                  std::this_thread::yield();
+                }
+
+                std::scoped_lock lock(mutex);
+                ids.insert(std::this_thread::get_id());
+                cpus.insert(StaticThreadPool::cpu);
+                return std::to_string(i);
+              });
+            })
+        | Collect<std::vector<std::string>>();
+  };
+
+  auto [future, k] = Terminate(e());
+
+  k.Start();
+
+  EXPECT_THAT(
+      future.get(),
+      this->OrderedOrUnorderedElementsAre("1", "2", "3", "4", "5"));
+
+  EXPECT_EQ(0, ids.count(std::this_thread::get_id()));
+
+  if (StaticThreadPool::Scheduler().concurrency > 1) {
+    EXPECT_GT(cpus.size(), 1);
+  }
+}
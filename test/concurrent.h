@@ -2,6 +2,7 @@
 
 #include "eventuals/concurrent-ordered.h"
 #include "eventuals/concurrent.h"
+#include "eventuals/parallel-concurrent.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -20,6 +21,26 @@ class ConcurrentTypedTest : public testing::Test {
     }
   }
 
+  template <typename F>
+  auto ConcurrentOrConcurrentOrdered(size_t n, F f) {
+    if constexpr (std::is_same_v<Type, ConcurrentType>) {
+      return eventuals::Concurrent(n, std::move(f));
+    } else {
+      return eventuals::ConcurrentOrdered(n, std::move(f));
+    }
+  }
+
+  template <typename F>
+  auto ParallelConcurrentOrParallelConcurrentOrdered(
+      eventuals::StaticThreadPool& pool,
+      F f) {
+    if constexpr (std::is_same_v<Type, ConcurrentType>) {
+      return eventuals::ParallelConcurrent(pool, std::move(f));
+    } else {
+      return eventuals::ParallelConcurrentOrdered(pool, std::move(f));
+    }
+  }
+
   template <typename... Args>
   auto OrderedOrUnorderedElementsAre(Args&&... args) {
     if constexpr (std::is_same_v<Type, ConcurrentType>) {
@@ -0,0 +1,130 @@
+#include <future>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "eventuals/event-loop.h"
+#include "eventuals/terminal.h"
+#include "eventuals/then.h"
+#include "gtest/gtest.h"
+
+using eventuals::EventLoop;
+using eventuals::EventLoopGroup;
+using eventuals::Then;
+
+class EventLoopGroupTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    EventLoopGroup::ConstructDefault(4);
+  }
+
+  void TearDown() override {
+    EventLoopGroup::DestructDefault();
+  }
+};
+
+TEST_F(EventLoopGroupTest, Schedule) {
+  auto& group = EventLoopGroup::Default();
+
+  std::set<std::thread::id> threads;
+
+  for (unsigned int cpu = 0; cpu < group.size(); cpu++) {
+    auto& loop = EventLoop::ForCPU(cpu);
+
+    auto e = [&]() {
+      return loop.Schedule(Then([&]() {
+        EXPECT_EQ(&loop, EventLoop::Current());
+        return std::this_thread::get_id();
+      }));
+    };
+
+    threads.insert(*e());
+  }
+
+  // Each loop is run by its own thread.
+  EXPECT_EQ(group.size(), threads.size());
+}
+
+TEST_F(EventLoopGroupTest, ForCPU) {
+  auto& group = EventLoopGroup::Default();
+
+  EXPECT_EQ(&EventLoop::ForCPU(0), &EventLoop::ForCPU(group.size()));
+  EXPECT_NE(&EventLoop::ForCPU(0), &EventLoop::ForCPU(1));
+}
+
+TEST_F(EventLoopGroupTest, LeastLoaded) {
+  auto& group = EventLoopGroup::Default();
+
+  std::set<EventLoop*> loops;
+
+  for (size_t i = 0; i < group.size(); i++) {
+    loops.insert(&group.ForCPU(i));
+  }
+
+  for (size_t i = 0; i < 10; i++) {
+    EXPECT_EQ(1u, loops.count(&EventLoop::LeastLoaded()));
+  }
+
+  // Now load the first loop by blocking it and then submitting more
+  // work to it that it can't get to yet.
+  auto& loaded = group.ForCPU(0);
+
+  std::promise<void> blocked;
+  std::promise<void> unblock;
+
+  std::thread blocker([&]() {
+    auto e = [&]() {
+      return loaded.Schedule(Then([&]() {
+        blocked.set_value();
+        unblock.get_future().wait();
+      }));
+    };
+    *e();
+  });
+
+  blocked.get_future().wait();
+
+  std::thread waiter([&]() {
+    auto e = [&]() {
+      return loaded.Schedule(Then([]() {}));
+    };
+    *e();
+  });
+
+  while (loaded.Load() == 0) {
+    std::this_thread::yield();
+  }
+
+  for (size_t i = 0; i < 10; i++) {
+    EXPECT_NE(&loaded, &EventLoop::LeastLoaded());
+  }
+
+  unblock.set_value();
+
+  blocker.join();
+  waiter.join();
+}
+
+TEST_F(EventLoopGroupTest, Timers) {
+  auto& group = EventLoopGroup::Default();
+
+  std::vector<EventLoop*> loops;
+
+  for (size_t i = 0; i < group.size(); i++) {
+    auto& loop = group.ForCPU(i);
+
+    auto e = [&]() {
+      return loop.Schedule(
+          loop.clock().Timer(std::chrono::milliseconds(10))
+          | Then([]() {
+              return EventLoop::Current();
+            }));
+    };
+
+    loops.push_back(*e());
+  }
+
+  for (size_t i = 0; i < group.size(); i++) {
+    EXPECT_EQ(&group.ForCPU(i), loops[i]);
+  }
+}
@@ -2,6 +2,7 @@
 
 #include <tuple>
 
+#include "eventuals/grpc/method.h"
 #include "eventuals/grpc/server.h"
 #include "eventuals/task.h"
 #include "eventuals/then.h"
@@ -16,6 +17,16 @@ class Greeter {
     return helloworld::Greeter::service_full_name();
   }
 
+  // Resolved and validated on first use, for 'Client::Call()'.
+  static const auto& SayHelloMethod() {
+    static const ::eventuals::grpc::MethodHandle<
+        Greeter,
+        HelloRequest,
+        HelloReply>
+        method("SayHello");
+    return method;
+  }
+
   class TypeErasedService : public ::eventuals::grpc::Service {
    public:
     ::eventuals::Task::Of<void>::Raises<std::exception> Serve() override;
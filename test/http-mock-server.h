@@ -45,7 +45,9 @@ class HttpMockServer final {
           asio::buffer(data, kBufferSize),
           /* flags = */ 0,
           error);
-      if (error) {
+      if (error == asio::error::eof) {
+        return std::string();
+      } else if (error) {
         ADD_FAILURE() << "Failed to receive: " << error.message();
         return std::string();
       } else {
@@ -82,7 +84,10 @@ class HttpMockServer final {
       asio::error_code error;
       char data[kBufferSize];
       size_t bytes = stream_.read_some(asio::buffer(data, kBufferSize), error);
-      if (error) {
+      if (error == asio::error::eof
+          || error == asio::ssl::error::stream_truncated) {
+        return std::string();
+      } else if (error) {
         ADD_FAILURE() << "Failed to receive: " << error.message();
         return std::string();
       } else {
@@ -271,6 +276,21 @@ class HttpMockServer final {
     }
   }
 
+  // Like 'Client()' except using 'loop' for requests.
+  eventuals::http::Client Client(eventuals::EventLoop& loop) {
+    if (scheme_ == "https://") {
+      CHECK(certificate_);
+      return eventuals::http::Client::Builder()
+          .certificate(x509::Certificate(*certificate_))
+          .loop(loop)
+          .Build();
+    } else {
+      return eventuals::http::Client::Builder()
+          .loop(loop)
+          .Build();
+    }
+  }
+
   unsigned short port() const {
     return endpoint_.port();
   }
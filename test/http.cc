@@ -1,25 +1,43 @@
 #include "eventuals/http.h"
 
 #include "event-loop-test.h"
+#include "eventuals/collect.h"
 #include "eventuals/eventual.h"
 #include "eventuals/interrupt.h"
+#include "eventuals/iterate.h"
+#include "eventuals/just.h"
 #include "eventuals/let.h"
+#include "eventuals/map.h"
+#include "eventuals/raise.h"
+#include "eventuals/reduce.h"
 #include "eventuals/scheduler.h"
+#include "eventuals/take.h"
 #include "eventuals/terminal.h"
 #include "eventuals/then.h"
+#include "eventuals/timer.h"
 #include "eventuals/type-traits.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "test/expect-throw-what.h"
 #include "test/http-mock-server.h"
 
 namespace http = eventuals::http;
 
+using eventuals::Collect;
 using eventuals::EventLoop;
+using eventuals::EventLoopGroup;
 using eventuals::Interrupt;
+using eventuals::Iterate;
+using eventuals::Just;
 using eventuals::Let;
+using eventuals::Map;
+using eventuals::Raise;
+using eventuals::Reduce;
 using eventuals::Scheduler;
+using eventuals::TakeFirstN;
 using eventuals::Terminate;
 using eventuals::Then;
+using eventuals::Timer;
 
 class HttpTest
   : public EventLoopTest,
@@ -29,6 +47,38 @@ const char* schemes[] = {"http://", "https://"};
 
 INSTANTIATE_TEST_SUITE_P(Schemes, HttpTest, testing::ValuesIn(schemes));
 
+TEST(HeaderTableTest, Parse) {
+  http::HeaderTable headers(
+      "HTTP/1.1 200 OK\r\n"
+      "Foo:  Bar1 \r\n"
+      "Content-Length: 25\r\n"
+      "foo: Bar2\r\n"
+      "FOO:Bar3\n"
+      "\r\n");
+
+  EXPECT_EQ(2, headers.size());
+
+  EXPECT_THAT(
+      headers,
+      testing::ElementsAre(
+          testing::Pair("Foo", "Bar1, Bar2, Bar3"),
+          testing::Pair("Content-Length", "25")));
+
+  EXPECT_EQ("Bar1, Bar2, Bar3", headers.Find("foo"));
+  EXPECT_EQ("25", headers.Find("CONTENT-LENGTH"));
+  EXPECT_EQ(std::nullopt, headers.Find("Bar"));
+
+  // Keys and values must still be valid after copying and moving.
+  http::HeaderTable copy = headers;
+  http::HeaderTable moved = std::move(headers);
+
+  EXPECT_EQ("25", copy.Find("content-length"));
+  EXPECT_EQ("Bar1, Bar2, Bar3", moved.Find("Foo"));
+
+  EXPECT_TRUE(http::HeaderTable().empty());
+  EXPECT_EQ(std::nullopt, http::HeaderTable().Find("Foo"));
+}
+
 TEST_P(HttpTest, Get) {
   std::string scheme = GetParam();
 
@@ -75,6 +125,47 @@ TEST_P(HttpTest, Get) {
 }
 
 
+TEST_P(HttpTest, GetEventLoopGroup) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  EventLoopGroup group(2);
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .Times(group.size())
+      .WillRepeatedly([](auto socket, const std::string& data) {
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 25\r\n"
+            "\r\n"
+            "<html>Hello World!</html>\r\n"
+            "\r\n");
+
+        socket->Close();
+      });
+
+  // One client (and thus one connection pool) for each loop.
+  for (size_t i = 0; i < group.size(); i++) {
+    auto& loop = group.ForCPU(i);
+
+    http::Client client = server.Client(loop);
+
+    auto e = [&]() {
+      return client.Get(server.uri())
+          | Then([&](auto&& response) {
+               EXPECT_EQ(&loop, EventLoop::Current());
+               return std::move(response);
+             });
+    };
+
+    auto response = *loop.Schedule(e());
+
+    EXPECT_EQ(200, response.code());
+    EXPECT_EQ("<html>Hello World!</html>", response.body());
+  }
+}
+
 TEST_P(HttpTest, GetGet) {
   std::string scheme = GetParam();
 
@@ -140,6 +231,125 @@ TEST_P(HttpTest, GetGet) {
 }
 
 
+TEST_P(HttpTest, GetGetKeepAlive) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  auto client = [&]() {
+    if (scheme == "https://") {
+      return http::Client::Builder()
+          .certificate(x509::Certificate(*server.certificate()))
+          .pool_size(1)
+          .idle_timeout(std::chrono::seconds(30))
+          .Build();
+    } else {
+      return http::Client::Builder()
+          .pool_size(1)
+          .idle_timeout(std::chrono::seconds(30))
+          .Build();
+    }
+  }();
+
+  // NOTE: expecting both requests on the same connection, so if a
+  // second connection gets made it won't get accepted until after
+  // the first request times out (and the test fails).
+  EXPECT_CALL(server, Accepted)
+      .WillOnce([](auto socket) {
+        for (const std::string body : {"Hello Nikita!", "Hello Ben!"}) {
+          std::string data;
+
+          do {
+            std::string buffer = socket->Receive();
+            if (buffer.empty()) {
+              socket->Close();
+              return;
+            }
+            data += buffer;
+          } while (data.find("\r\n\r\n") == std::string::npos);
+
+          socket->Send(
+              "HTTP/1.1 200 OK\r\n"
+              "Content-Length: "
+              + std::to_string(body.size())
+              + "\r\n"
+                "\r\n"
+              + body);
+        }
+
+        socket->Close();
+      });
+
+  auto e = client.Get(server.uri(), std::chrono::seconds(5))
+      | Then(Let([&](auto& response1) {
+             return client.Get(server.uri(), std::chrono::seconds(5))
+                 | Then([&](auto&& response2) {
+                      return std::tuple{response1, response2};
+                    });
+           }));
+
+  auto [future, k] = Terminate(std::move(e));
+
+  k.Start();
+
+  EventLoop::Default().RunUntil(future);
+
+  auto [response1, response2] = future.get();
+
+  EXPECT_EQ(200, response1.code());
+  EXPECT_EQ("Hello Nikita!", response1.body());
+
+  EXPECT_EQ(200, response2.code());
+  EXPECT_EQ("Hello Ben!", response2.body());
+}
+
+// NOTE: the mock server only speaks HTTP/1.1 (and doesn't do ALPN)
+// so this tests that a client configured for HTTP/2 falls back.
+TEST_P(HttpTest, GetHttp2Fallback) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  auto client = [&]() {
+    if (scheme == "https://") {
+      return http::Client::Builder()
+          .certificate(x509::Certificate(*server.certificate()))
+          .http2(true)
+          .max_concurrent_streams(8)
+          .Build();
+    } else {
+      return http::Client::Builder()
+          .http2(true)
+          .max_concurrent_streams(8)
+          .Build();
+    }
+  }();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        EXPECT_THAT(data, testing::StartsWith("GET / HTTP/1.1\r\n"));
+
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 25\r\n"
+            "\r\n"
+            "<html>Hello World!</html>");
+
+        socket->Close();
+      });
+
+  auto [future, k] = Terminate(client.Get(server.uri()));
+  k.Start();
+
+  EventLoop::Default().RunUntil(future);
+
+  auto response = future.get();
+
+  EXPECT_EQ(200, response.code());
+  EXPECT_EQ("<html>Hello World!</html>", response.body());
+}
+
+
 TEST_P(HttpTest, GetFailTimeout) {
   std::string scheme = GetParam();
 
@@ -380,5 +590,362 @@ TEST_P(HttpTest, GetDuplicateHeaders) {
   EXPECT_THAT(
       response.headers(),
       testing::Contains(http::Header("Content-Length", "25")));
+  EXPECT_EQ("Bar1, Bar2", response.header_table().Find("foo"));
+  EXPECT_EQ("25", response.header_table().Find("content-length"));
   EXPECT_EQ("<html>Hello World!</html>", response.body());
 }
+
+
+TEST_P(HttpTest, Stream) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  http::Client client = server.Client();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n");
+
+        for (const std::string chunk : {"Hello ", "World", "!"}) {
+          std::stringstream size;
+          size << std::hex << chunk.size();
+          socket->Send(size.str() + "\r\n" + chunk + "\r\n");
+        }
+
+        socket->Send("0\r\n\r\n");
+
+        socket->Close();
+      });
+
+  auto e = client.Stream(
+               http::Request::Builder()
+                   .uri(server.uri())
+                   .method(http::GET)
+                   .Build())
+      | Reduce(
+               std::string(),
+               [](auto& body) {
+                 return Then([&](auto&& chunk) {
+                   body += chunk;
+                   return true;
+                 });
+               });
+
+  static_assert(
+      eventuals::tuple_types_unordered_equals_v<
+          typename decltype(e)::template ErrorsFrom<void, std::tuple<>>,
+          std::tuple<std::runtime_error>>);
+
+  auto [future, k] = Terminate(std::move(e));
+  k.Start();
+
+  EventLoop::Default().RunUntil(future);
+
+  EXPECT_EQ("Hello World!", future.get());
+}
+
+
+TEST_P(HttpTest, StreamErrorStatus) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  http::Client client = server.Client();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        socket->Send(
+            "HTTP/1.1 404 Not Found\r\n"
+            "Content-Length: 25\r\n"
+            "\r\n"
+            "<html>Not Found!</html>\r\n");
+
+        socket->Close();
+      });
+
+  size_t chunks = 0;
+
+  auto e = client.Stream(
+               http::Request::Builder()
+                   .uri(server.uri())
+                   .method(http::GET)
+                   .Build())
+      | Map([&](auto&& chunk) {
+             chunks++;
+             return std::move(chunk);
+           })
+      | Collect<std::vector<std::string>>();
+
+  auto [future, k] = Terminate(std::move(e));
+  k.Start();
+
+  EventLoop::Default().RunUntil(future);
+
+  EXPECT_THROW_WHAT(
+      future.get(),
+      "HTTP request failed with status code 404");
+
+  // None of the body of the error page should have been propagated.
+  EXPECT_EQ(0, chunks);
+}
+
+
+TEST_P(HttpTest, StreamTake) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  http::Client client = server.Client();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 1000000\r\n"
+            "\r\n");
+
+        // NOTE: not sending the entire body so the transfer only
+        // completes because we're done after the first chunk, but
+        // sending more than a single chunk (at most 16KB, see
+        // 'CURL_MAX_WRITE_SIZE') so that 'TakeFirstN()' gets a
+        // second chunk at which point it will be done.
+        for (size_t i = 0; i < 8; i++) {
+          socket->Send(std::string(8192, 'x'));
+        }
+      });
+
+  auto e = client.Stream(
+               http::Request::Builder()
+                   .uri(server.uri())
+                   .method(http::GET)
+                   .Build())
+      | TakeFirstN(1)
+      | Collect<std::vector<std::string>>();
+
+  auto [future, k] = Terminate(std::move(e));
+  k.Start();
+
+  EventLoop::Default().RunUntil(future);
+
+  auto chunks = future.get();
+
+  ASSERT_EQ(1, chunks.size());
+  EXPECT_THAT(chunks[0], testing::Not(testing::IsEmpty()));
+  EXPECT_THAT(chunks[0], testing::Each('x'));
+}
+
+
+TEST_P(HttpTest, StreamBackpressure) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  http::Client client = server.Client();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 65536\r\n"
+            "\r\n");
+
+        for (size_t i = 0; i < 8; i++) {
+          socket->Send(std::string(8192, 'x'));
+        }
+
+        socket->Close();
+      });
+
+  // NOTE: using a 'Timer()' so that downstream asks for the next
+  // chunk asynchronously which means the transfer will get paused if
+  // libcurl has more to write in the meantime.
+  auto e = client.Stream(
+               http::Request::Builder()
+                   .uri(server.uri())
+                   .method(http::GET)
+                   .Build())
+      | Map([](std::string&& chunk) {
+             return Timer(std::chrono::milliseconds(1))
+                 | Then([chunk = std::move(chunk)]() {
+                      return chunk.size();
+                    });
+           })
+      | Reduce(
+               size_t(0),
+               [](auto& size) {
+                 return Then([&](size_t bytes) {
+                   size += bytes;
+                   return true;
+                 });
+               });
+
+  auto [future, k] = Terminate(std::move(e));
+  k.Start();
+
+  EventLoop::Default().RunUntil(future);
+
+  EXPECT_EQ(65536, future.get());
+}
+
+TEST_P(HttpTest, StreamInterruptAfterStart) {
+  std::string scheme = GetParam();
+
+  auto e = http::Client().Stream(
+               http::Request::Builder()
+                   .uri(scheme + "example.com")
+                   .method(http::GET)
+                   .Build())
+      | Collect<std::vector<std::string>>();
+
+  auto [future, k] = Terminate(std::move(e));
+
+  Interrupt interrupt;
+
+  k.Register(interrupt);
+
+  k.Start();
+
+  // NOTE: see comment in 'GetInterruptAfterStart' for why we submit
+  // the interrupt to the event loop.
+  Scheduler::Context context(&EventLoop::Default(), "interrupt.Trigger()");
+
+  EventLoop::Default().Submit(
+      [&interrupt]() {
+        interrupt.Trigger();
+      },
+      &context);
+
+  EventLoop::Default().RunUntil(future);
+
+  EXPECT_THROW(future.get(), eventuals::StoppedException);
+}
+
+
+// Helper that receives a request with a chunked body, responding to
+// any 'Expect: 100-continue' along the way, and returns everything
+// that was received or an empty string if the socket was closed.
+static std::string ReceiveChunked(HttpMockServer::Socket& socket) {
+  std::string data;
+
+  bool continued = false;
+
+  do {
+    std::string buffer = socket.Receive();
+    if (buffer.empty()) {
+      return std::string();
+    }
+    data += buffer;
+
+    if (!continued
+        && data.find("\r\n\r\n") != std::string::npos
+        && data.find("Expect: 100-continue") != std::string::npos) {
+      socket.Send("HTTP/1.1 100 Continue\r\n\r\n");
+      continued = true;
+    }
+  } while (data.find("\r\n0\r\n\r\n") == std::string::npos);
+
+  return data;
+}
+
+
+TEST_P(HttpTest, PostBody) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  http::Client client = server.Client();
+
+  EXPECT_CALL(server, Accepted)
+      .WillOnce([](auto socket) {
+        std::string data = ReceiveChunked(*socket);
+
+        EXPECT_THAT(data, testing::HasSubstr("Transfer-Encoding: chunked"));
+        EXPECT_THAT(
+            data,
+            testing::HasSubstr(
+                "6\r\nHello \r\n"
+                "5\r\nWorld\r\n"
+                "1\r\n!\r\n"
+                "0\r\n\r\n"));
+
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 2\r\n"
+            "\r\n"
+            "OK");
+
+        socket->Close();
+      });
+
+  // NOTE: using a 'Timer()' so that the stream gets each chunk
+  // asynchronously which means the upload will get paused.
+  auto e = client.Do(
+      http::Request::Builder()
+          .uri(server.uri())
+          .method(http::POST)
+          .body(
+              Iterate(std::vector<std::string>({"Hello ", "World", "!"}))
+              | Map([](std::string&& chunk) {
+                  return Timer(std::chrono::milliseconds(1))
+                      | Then([chunk = std::move(chunk)]() {
+                           return chunk;
+                         });
+                }))
+          .Build());
+
+  auto [future, k] = Terminate(std::move(e));
+  k.Start();
+
+  EventLoop::Default().RunUntil(future);
+
+  auto response = future.get();
+
+  EXPECT_EQ(200, response.code());
+  EXPECT_EQ("OK", response.body());
+}
+
+
+TEST_P(HttpTest, PostBodyFail) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  http::Client client = server.Client();
+
+  EXPECT_CALL(server, Accepted)
+      .WillOnce([](auto socket) {
+        // NOTE: expecting the socket to get closed because the upload
+        // gets aborted.
+        EXPECT_EQ("", ReceiveChunked(*socket));
+        socket->Close();
+      });
+
+  auto e = client.Do(
+      http::Request::Builder()
+          .uri(server.uri())
+          .method(http::POST)
+          .body(
+              Iterate(std::vector<std::string>({"Hello ", "World", "!"}))
+              | Map([](std::string&& chunk) {
+                  return Just(std::move(chunk))
+                      | Raise(std::runtime_error("Failed to read"));
+                }))
+          .Build());
+
+  auto [future, k] = Terminate(std::move(e));
+  k.Start();
+
+  EventLoop::Default().RunUntil(future);
+
+  EXPECT_THROW_WHAT(future.get(), "Failed to read");
+}
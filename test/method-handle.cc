@@ -0,0 +1,124 @@
+#include "eventuals/grpc/client.h"
+#include "eventuals/grpc/method.h"
+#include "eventuals/grpc/server.h"
+#include "eventuals/head.h"
+#include "eventuals/let.h"
+#include "eventuals/loop.h"
+#include "eventuals/map.h"
+#include "eventuals/then.h"
+#include "examples/protos/helloworld.grpc.pb.h"
+#include "gtest/gtest.h"
+#include "test/expect-throw-what.h"
+#include "test/helloworld.eventuals.h"
+#include "test/test.h"
+
+using helloworld::Greeter;
+using helloworld::HelloReply;
+using helloworld::HelloRequest;
+
+using stout::Borrowable;
+
+using eventuals::Head;
+using eventuals::Let;
+using eventuals::Loop;
+using eventuals::Map;
+using eventuals::Terminate;
+using eventuals::Then;
+
+using eventuals::grpc::Client;
+using eventuals::grpc::CompletionPool;
+using eventuals::grpc::MethodHandle;
+using eventuals::grpc::ServerBuilder;
+using eventuals::grpc::Stream;
+
+TEST_F(EventualsGrpcTest, MethodHandle) {
+  ServerBuilder builder;
+
+  int port = 0;
+
+  builder.AddListeningPort(
+      "0.0.0.0:0",
+      grpc::InsecureServerCredentials(),
+      &port);
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+
+  auto server = std::move(build.server);
+
+  ASSERT_TRUE(server);
+
+  auto serve = [&]() {
+    return server->Accept<Greeter, HelloRequest, HelloReply>("SayHello")
+        | Head()
+        | Then(Let([](auto& call) {
+             return call.Reader().Read()
+                 | Head()
+                 | Then([](auto&& request) {
+                      HelloReply reply;
+                      std::string prefix("Hello ");
+                      reply.set_message(prefix + request.name());
+                      return reply;
+                    })
+                 | UnaryEpilogue(call);
+           }));
+  };
+
+  auto [cancelled, k] = Terminate(serve());
+
+  k.Start();
+
+  Borrowable<CompletionPool> pool;
+
+  Client client(
+      "0.0.0.0:" + std::to_string(port),
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  const auto& method = helloworld::eventuals::Greeter::SayHelloMethod();
+
+  ASSERT_FALSE(method.method().error());
+  EXPECT_EQ("/helloworld.Greeter/SayHello", method.method().path());
+
+  auto call = [&]() {
+    return client.Call(method)
+        | Then(Let([](auto& call) {
+             HelloRequest request;
+             request.set_name("emily");
+             return call.Writer().WriteLast(request)
+                 | call.Reader().Read()
+                 | Map([](auto&& response) {
+                      EXPECT_EQ("Hello emily", response.message());
+                    })
+                 | Loop()
+                 | call.Finish();
+           }));
+  };
+
+  auto status = *call();
+
+  EXPECT_TRUE(status.ok());
+
+  EXPECT_FALSE(cancelled.get());
+}
+
+
+TEST_F(EventualsGrpcTest, MethodHandleInvalid) {
+  Borrowable<CompletionPool> pool;
+
+  Client client(
+      "0.0.0.0:0",
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  MethodHandle<Greeter, HelloRequest, Stream<HelloReply>> method("SayHello");
+
+  ASSERT_TRUE(method.method().error());
+
+  auto call = [&]() {
+    return client.Call(method);
+  };
+
+  EXPECT_THROW_WHAT(*call(), "Method does not have streaming responses");
+}
@@ -0,0 +1,97 @@
+#include "eventuals/grpc/client.h"
+#include "eventuals/grpc/server.h"
+#include "eventuals/head.h"
+#include "eventuals/let.h"
+#include "eventuals/terminal.h"
+#include "eventuals/then.h"
+#include "examples/protos/helloworld.grpc.pb.h"
+#include "gtest/gtest.h"
+#include "test/test.h"
+
+using helloworld::Greeter;
+using helloworld::HelloReply;
+using helloworld::HelloRequest;
+
+using stout::Borrowable;
+
+using eventuals::ChannelOverflow;
+using eventuals::Head;
+using eventuals::Let;
+using eventuals::Terminate;
+using eventuals::Then;
+
+using eventuals::grpc::Client;
+using eventuals::grpc::CompletionPool;
+using eventuals::grpc::Server;
+using eventuals::grpc::ServerBuilder;
+
+TEST_F(EventualsGrpcTest, QueuedCallsOverflow) {
+  ServerBuilder builder;
+
+  builder.SetMaximumQueuedCallsPerEndpoint(2, ChannelOverflow::Reject);
+
+  int port = 0;
+
+  builder.AddListeningPort(
+      "0.0.0.0:0",
+      grpc::InsecureServerCredentials(),
+      &port);
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+
+  auto server = std::move(build.server);
+
+  ASSERT_TRUE(server);
+
+  // Only accept the first call so any others get queued.
+  auto serve = [&]() {
+    return server->Accept<Greeter, HelloRequest, HelloReply>("SayHello")
+        | Head()
+        | Then(Let([](auto& call) {
+             return call.WaitForDone();
+           }));
+  };
+
+  auto [cancelled, k] = Terminate(serve());
+
+  k.Start();
+
+  Borrowable<CompletionPool> pool;
+
+  Client client(
+      "0.0.0.0:" + std::to_string(port),
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  auto call = [&]() {
+    return client.Context()
+        | Then([&](auto* context) {
+             auto now = std::chrono::system_clock::now();
+             context->set_deadline(now + std::chrono::milliseconds(100));
+
+             return client.Call<Greeter, HelloRequest, HelloReply>(
+                        "SayHello",
+                        context)
+                 | Then(Let([](auto& call) {
+                      HelloRequest request;
+                      request.set_name("emily");
+                      return call.Writer().WriteLast(request)
+                          | call.Finish();
+                    }));
+           });
+  };
+
+  // First call gets accepted but never replied to.
+  EXPECT_EQ(grpc::DEADLINE_EXCEEDED, (*call()).error_code());
+
+  // Second and third calls get queued.
+  EXPECT_EQ(grpc::DEADLINE_EXCEEDED, (*call()).error_code());
+  EXPECT_EQ(grpc::DEADLINE_EXCEEDED, (*call()).error_code());
+
+  // Fourth call gets rejected because the queue is full.
+  EXPECT_EQ(grpc::RESOURCE_EXHAUSTED, (*call()).error_code());
+
+  EXPECT_TRUE(cancelled.get());
+}
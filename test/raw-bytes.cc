@@ -0,0 +1,247 @@
+#include "eventuals/grpc/client.h"
+#include "eventuals/grpc/server.h"
+#include "eventuals/head.h"
+#include "eventuals/let.h"
+#include "eventuals/loop.h"
+#include "eventuals/map.h"
+#include "eventuals/then.h"
+#include "examples/protos/helloworld.grpc.pb.h"
+#include "examples/protos/keyvaluestore.grpc.pb.h"
+#include "gtest/gtest.h"
+#include "test/test.h"
+
+using helloworld::Greeter;
+using helloworld::HelloReply;
+using helloworld::HelloRequest;
+
+using stout::Borrowable;
+
+using eventuals::Head;
+using eventuals::Let;
+using eventuals::Loop;
+using eventuals::Map;
+using eventuals::Terminate;
+using eventuals::Then;
+
+using eventuals::grpc::Client;
+using eventuals::grpc::CompletionPool;
+using eventuals::grpc::RawBytes;
+using eventuals::grpc::ServerBuilder;
+using eventuals::grpc::Stream;
+
+TEST_F(EventualsGrpcTest, RawBytesServer) {
+  ServerBuilder builder;
+
+  int port = 0;
+
+  builder.AddListeningPort(
+      "0.0.0.0:0",
+      grpc::InsecureServerCredentials(),
+      &port);
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+
+  auto server = std::move(build.server);
+
+  ASSERT_TRUE(server);
+
+  // Echo the request bytes back without parsing them, which works
+  // because 'HelloRequest' and 'HelloReply' have the same layout.
+  auto serve = [&]() {
+    return server->Accept<RawBytes, RawBytes>("helloworld.Greeter.SayHello")
+        | Head()
+        | Then(Let([](auto& call) {
+             return UnaryPrologue(call)
+                 | UnaryEpilogue(call);
+           }));
+  };
+
+  auto [cancelled, k] = Terminate(serve());
+
+  k.Start();
+
+  Borrowable<CompletionPool> pool;
+
+  Client client(
+      "0.0.0.0:" + std::to_string(port),
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  auto call = [&]() {
+    return client.Call<Greeter, HelloRequest, HelloReply>("SayHello")
+        | Then(Let([](auto& call) {
+             HelloRequest request;
+             request.set_name("emily");
+             return call.Writer().WriteLast(request)
+                 | call.Reader().Read()
+                 | Map([](auto&& response) {
+                      EXPECT_EQ("emily", response.message());
+                    })
+                 | Loop()
+                 | call.Finish();
+           }));
+  };
+
+  auto status = *call();
+
+  EXPECT_TRUE(status.ok());
+
+  EXPECT_FALSE(cancelled.get());
+}
+
+
+TEST_F(EventualsGrpcTest, RawBytesClient) {
+  ServerBuilder builder;
+
+  int port = 0;
+
+  builder.AddListeningPort(
+      "0.0.0.0:0",
+      grpc::InsecureServerCredentials(),
+      &port);
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+
+  auto server = std::move(build.server);
+
+  ASSERT_TRUE(server);
+
+  auto serve = [&]() {
+    return server->Accept<Greeter, HelloRequest, HelloReply>("SayHello")
+        | Head()
+        | Then(Let([](auto& call) {
+             return UnaryPrologue(call)
+                 | Then([](auto&& request) {
+                      HelloReply reply;
+                      std::string prefix("Hello ");
+                      reply.set_message(prefix + request.name());
+                      return reply;
+                    })
+                 | UnaryEpilogue(call);
+           }));
+  };
+
+  auto [cancelled, k] = Terminate(serve());
+
+  k.Start();
+
+  Borrowable<CompletionPool> pool;
+
+  Client client(
+      "0.0.0.0:" + std::to_string(port),
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  HelloRequest request;
+  request.set_name("emily");
+
+  RawBytes bytes;
+  bool own = true;
+  ASSERT_TRUE(
+      grpc::SerializationTraits<HelloRequest>::Serialize(request, &bytes, &own)
+          .ok());
+
+  auto call = [&]() {
+    return client.Call<RawBytes, RawBytes>("helloworld.Greeter.SayHello")
+        | Then(Let([&bytes](auto& call) {
+             return call.Writer().WriteLast(bytes)
+                 | call.Reader().Read()
+                 | Map([](RawBytes&& response) {
+                      HelloReply reply;
+                      EXPECT_TRUE(
+                          grpc::SerializationTraits<HelloReply>::Deserialize(
+                              &response,
+                              &reply)
+                              .ok());
+                      EXPECT_EQ("Hello emily", reply.message());
+                    })
+                 | Loop()
+                 | call.Finish();
+           }));
+  };
+
+  auto status = *call();
+
+  EXPECT_TRUE(status.ok());
+
+  EXPECT_FALSE(cancelled.get());
+}
+
+
+TEST_F(EventualsGrpcTest, RawBytesStreaming) {
+  ServerBuilder builder;
+
+  int port = 0;
+
+  builder.AddListeningPort(
+      "0.0.0.0:0",
+      grpc::InsecureServerCredentials(),
+      &port);
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+
+  auto server = std::move(build.server);
+
+  ASSERT_TRUE(server);
+
+  // Echo each request's bytes back without parsing them, which works
+  // because 'keyvaluestore::Request' and 'keyvaluestore::Response'
+  // have the same layout.
+  auto serve = [&]() {
+    return server->Accept<Stream<RawBytes>, Stream<RawBytes>>(
+               "keyvaluestore.KeyValueStore.GetValues")
+        | Head()
+        | Then(Let([](auto& call) {
+             return call.Reader().Read()
+                 | StreamingEpilogue(call);
+           }));
+  };
+
+  auto [cancelled, k] = Terminate(serve());
+
+  k.Start();
+
+  Borrowable<CompletionPool> pool;
+
+  Client client(
+      "0.0.0.0:" + std::to_string(port),
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  auto request = [](const char* key) {
+    keyvaluestore::Request request;
+    request.set_key(key);
+    return request;
+  };
+
+  auto call = [&]() {
+    return client.Call<
+               Stream<keyvaluestore::Request>,
+               Stream<keyvaluestore::Response>>(
+               "keyvaluestore.KeyValueStore.GetValues")
+        | Then(Let([&](auto& call) {
+             return call.Writer().Write(request("1"))
+                 | call.Writer().Write(request("2"))
+                 | call.Writer().Write(request("3"))
+                 | call.WritesDone()
+                 | call.Reader().Read()
+                 | Map([i = 1](auto&& response) mutable {
+                      EXPECT_EQ(std::to_string(i++), response.value());
+                    })
+                 | Loop()
+                 | call.Finish();
+           }));
+  };
+
+  auto status = *call();
+
+  EXPECT_TRUE(status.ok());
+
+  EXPECT_FALSE(cancelled.get());
+}
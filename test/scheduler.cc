@@ -0,0 +1,122 @@
+#include "eventuals/scheduler.h"
+
+#include <deque>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using eventuals::Scheduler;
+using eventuals::StaticName;
+
+TEST(SchedulerQueue, Fifo) {
+  std::deque<Scheduler::Context> contexts;
+  for (size_t i = 0; i < 3; i++) {
+    contexts.emplace_back(Scheduler::Default(), std::to_string(i));
+  }
+
+  Scheduler::Queue queue;
+
+  EXPECT_EQ(nullptr, queue.Pop());
+
+  queue.Push(&contexts[0]);
+  queue.Push(&contexts[1]);
+
+  EXPECT_EQ(&contexts[0], queue.Pop());
+
+  // Pushing while there are still contexts that were already taken
+  // by the consumer should still be FIFO.
+  queue.Push(&contexts[2]);
+
+  EXPECT_EQ(&contexts[1], queue.Pop());
+  EXPECT_EQ(&contexts[2], queue.Pop());
+  EXPECT_EQ(nullptr, queue.Pop());
+
+  for (auto& context : contexts) {
+    EXPECT_EQ(nullptr, context.next);
+  }
+}
+
+TEST(SchedulerQueue, Burst) {
+  constexpr size_t PRODUCERS = 4;
+
+  for (size_t burst : {1, 10, 100, 1000, 10000, 100000}) {
+    // Use the context's 'data' to remember the producer and the
+    // order in which each context was pushed.
+    struct Tag {
+      size_t producer;
+      size_t index;
+    };
+
+    std::vector<std::vector<Tag>> tags(PRODUCERS);
+    std::vector<std::deque<Scheduler::Context>> contexts(PRODUCERS);
+    for (size_t producer = 0; producer < PRODUCERS; producer++) {
+      for (size_t i = 0; i < burst; i++) {
+        tags[producer].push_back(Tag{producer, i});
+      }
+      for (auto& tag : tags[producer]) {
+        contexts[producer].emplace_back(Scheduler::Default(), "[burst]", &tag);
+      }
+    }
+
+    Scheduler::Queue queue;
+
+    std::vector<std::thread> threads;
+    for (size_t producer = 0; producer < PRODUCERS; producer++) {
+      threads.emplace_back([&, producer]() {
+        for (auto& context : contexts[producer]) {
+          queue.Push(&context);
+        }
+      });
+    }
+
+    // Each producer's contexts must be popped in the order they were
+    // pushed.
+    std::vector<size_t> expected(PRODUCERS, 0);
+
+    size_t popped = 0;
+    while (popped < PRODUCERS * burst) {
+      auto* context = queue.Pop();
+      if (context == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      auto* tag = static_cast<Tag*>(context->data);
+
+      EXPECT_EQ(expected[tag->producer]++, tag->index);
+
+      popped++;
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    EXPECT_EQ(nullptr, queue.Pop());
+  }
+}
+
+TEST(SchedulerContext, Name) {
+  Scheduler::Context literal(Scheduler::Default(), "literal");
+  EXPECT_EQ("literal", literal.name());
+
+  Scheduler::Context owned(Scheduler::Default(), std::string("owned"));
+  EXPECT_EQ("owned", owned.name());
+
+  StaticName interned = StaticName::Intern(std::string("inter") + "ned");
+
+  EXPECT_EQ(interned.c_str(), StaticName::Intern("interned").c_str());
+
+  Scheduler::Context context(Scheduler::Default(), interned);
+  EXPECT_EQ("interned", context.name());
+  EXPECT_EQ(interned.c_str(), context.name().data());
+
+  // A 'const char*' might not outlive the context so it must be
+  // either interned or copied into a 'std::string' instead.
+  static_assert(
+      !std::is_constructible_v<Scheduler::Context, Scheduler*, const char*>);
+  static_assert(!std::is_constructible_v<Scheduler::Context, const char*>);
+}
@@ -1,5 +1,12 @@
 #include "eventuals/static-thread-pool.h"
 
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "eventuals/closure.h"
@@ -22,11 +29,13 @@ using eventuals::Closure;
 using eventuals::Collect;
 using eventuals::Concurrent;
 using eventuals::Eventual;
+using eventuals::IdlePolicy;
 using eventuals::Iterate;
 using eventuals::Let;
 using eventuals::Loop;
 using eventuals::Map;
 using eventuals::Pinned;
+using eventuals::Placement;
 using eventuals::Repeat;
 using eventuals::Scheduler;
 using eventuals::StaticThreadPool;
@@ -237,4 +246,266 @@ TEST(StaticThreadPoolTest, Concurrent) {
   };
 
   EXPECT_THAT(*e(), UnorderedElementsAre(1, 2, 3));
-}
\ No newline at end of file
+}
+
+TEST(StaticThreadPoolTest, RequirementsName) {
+  static const char literal[] = "literal";
+
+  StaticThreadPool::Requirements requirements(literal);
+  EXPECT_EQ(literal, requirements.name.data());
+
+  // Copies must refer to the same static name rather than a copy.
+  StaticThreadPool::Requirements copy = requirements;
+  EXPECT_EQ(literal, copy.name.data());
+
+  StaticThreadPool::Requirements owned(std::string("owned"));
+  EXPECT_EQ("owned", owned.name);
+
+  // Copies must refer to their own copy of an owned name.
+  StaticThreadPool::Requirements owned_copy = owned;
+  EXPECT_EQ("owned", owned_copy.name);
+  EXPECT_NE(owned.name.data(), owned_copy.name.data());
+
+  static_assert(
+      !std::is_constructible_v<StaticThreadPool::Requirements, const char*>);
+}
+
+TEST(StaticThreadPoolTest, PlacementLeastLoaded) {
+  StaticThreadPool::Requirements requirements("least loaded");
+
+  EXPECT_FALSE(requirements.cpu());
+
+  auto e = [&]() {
+    return StaticThreadPool::Scheduler().Schedule(
+        &requirements,
+        Then([&]() {
+          EXPECT_TRUE(StaticThreadPool::member);
+          return StaticThreadPool::cpu;
+        }));
+  };
+
+  auto cpu = *e();
+
+  ASSERT_TRUE(requirements.cpu());
+  EXPECT_EQ(cpu, requirements.cpu().value());
+  EXPECT_LT(cpu, StaticThreadPool::Scheduler().concurrency);
+}
+
+TEST(StaticThreadPoolTest, PlacementRoundRobin) {
+  auto& pool = StaticThreadPool::Scheduler();
+
+  std::vector<std::unique_ptr<StaticThreadPool::Requirements>> requirements;
+
+  for (size_t i = 0; i < pool.concurrency; i++) {
+    requirements.push_back(
+        std::make_unique<StaticThreadPool::Requirements>(
+            "round robin " + std::to_string(i),
+            Pinned::Any(),
+            Placement::RoundRobin));
+  }
+
+  std::vector<unsigned int> cpus;
+
+  for (auto& requirements : requirements) {
+    cpus.push_back(*pool.Schedule(
+        requirements.get(),
+        Then([]() {
+          return StaticThreadPool::cpu;
+        })));
+  }
+
+  // Each consecutive placement should be on the next CPU.
+  for (size_t i = 1; i < cpus.size(); i++) {
+    EXPECT_EQ((cpus[i - 1] + 1) % pool.concurrency, cpus[i]);
+  }
+}
+
+TEST(StaticThreadPoolTest, PlacementCurrent) {
+  auto& pool = StaticThreadPool::Scheduler();
+
+  StaticThreadPool::Requirements outer(
+      "outer",
+      Pinned::ExactCPU(pool.concurrency - 1));
+
+  StaticThreadPool::Requirements inner(
+      "inner",
+      Pinned::Any(),
+      Placement::Current);
+
+  auto e = [&]() {
+    return pool.Schedule(
+        &outer,
+        pool.Schedule(
+            &inner,
+            Then([]() {
+              return StaticThreadPool::cpu;
+            })));
+  };
+
+  EXPECT_EQ(pool.concurrency - 1, *e());
+  EXPECT_EQ(pool.concurrency - 1, inner.cpu().value());
+}
+
+TEST(StaticThreadPoolTest, PlacementConcurrent) {
+  auto& pool = StaticThreadPool::Scheduler();
+
+  StaticThreadPool::Requirements requirements("placed concurrently");
+
+  std::mutex mutex;
+  std::set<unsigned int> cpus;
+
+  // Everything racing to place the same requirements must end up on
+  // the same CPU and leave every CPU's load as it was.
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4 * pool.concurrency; i++) {
+    threads.emplace_back([&]() {
+      *pool.Schedule(
+          &requirements,
+          Then([&]() {
+            std::scoped_lock lock(mutex);
+            cpus.insert(StaticThreadPool::cpu);
+          }));
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_TRUE(requirements.cpu());
+  EXPECT_THAT(cpus, testing::ElementsAre(requirements.cpu().value()));
+
+  for (unsigned int cpu = 0; cpu < pool.concurrency; cpu++) {
+    EXPECT_EQ(0, pool.Load(cpu)) << "CPU " << cpu;
+  }
+}
+
+TEST(StaticThreadPoolTest, WorkStealing) {
+  auto& pool = StaticThreadPool::Scheduler();
+
+  StaticThreadPool::Requirements requirements(
+      "work stealing",
+      Pinned::Any(),
+      Placement::WorkStealing);
+
+  EXPECT_TRUE(requirements.stealable);
+
+  std::mutex mutex;
+  std::set<unsigned int> cpus;
+
+  // Deliberately imbalanced: everything gets submitted to the single
+  // CPU that the requirements get placed on so any other CPUs that
+  // run a context must have stolen it.
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4 * pool.concurrency; i++) {
+    threads.emplace_back([&]() {
+      *pool.Schedule(
+          &requirements,
+          Then([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            std::scoped_lock lock(mutex);
+            cpus.insert(StaticThreadPool::cpu);
+          }));
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (pool.concurrency > 1) {
+    EXPECT_LT(1, cpus.size());
+  } else {
+    EXPECT_EQ(1, cpus.size());
+  }
+}
+
+TEST(StaticThreadPoolTest, WorkStealingPinned) {
+  auto& pool = StaticThreadPool::Scheduler();
+
+  // Explicitly pinned requirements must never migrate.
+  StaticThreadPool::Requirements requirements(
+      "work stealing pinned",
+      Pinned::ExactCPU(pool.concurrency - 1),
+      Placement::WorkStealing);
+
+  EXPECT_FALSE(requirements.stealable);
+
+  std::mutex mutex;
+  std::set<unsigned int> cpus;
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4 * pool.concurrency; i++) {
+    threads.emplace_back([&]() {
+      *pool.Schedule(
+          &requirements,
+          Then([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            std::scoped_lock lock(mutex);
+            cpus.insert(StaticThreadPool::cpu);
+          }));
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_THAT(cpus, testing::ElementsAre(pool.concurrency - 1));
+}
+
+TEST(StaticThreadPoolTest, IdleParks) {
+  auto& pool = StaticThreadPool::Scheduler();
+
+  StaticThreadPool::Requirements requirements(
+      "parks",
+      Pinned::ExactCPU(pool.concurrency - 1));
+
+  auto before = pool.Statistics(pool.concurrency - 1);
+
+  for (size_t i = 0; i < 10; i++) {
+    *pool.Schedule(&requirements, Then([]() {}));
+    // Give the thread a chance to park.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  auto after = pool.Statistics(pool.concurrency - 1);
+
+  EXPECT_GT(after.parks, before.parks);
+  EXPECT_GT(after.wakeups, before.wakeups);
+}
+
+TEST(StaticThreadPoolTest, IdleSpins) {
+  auto& pool = StaticThreadPool::Scheduler();
+
+  IdlePolicy policy;
+  policy.spin = std::chrono::milliseconds(10);
+  policy.yield = std::chrono::milliseconds(100);
+
+  pool.SetIdlePolicy(policy);
+
+  // Restore the default policy even if an assertion fails so that we
+  // don't leave the threads spinning for any later tests.
+  struct Restore final {
+    ~Restore() {
+      StaticThreadPool::Scheduler().SetIdlePolicy(IdlePolicy());
+    }
+  } restore;
+
+  StaticThreadPool::Requirements requirements(
+      "spins",
+      Pinned::ExactCPU(pool.concurrency - 1));
+
+  auto before = pool.Statistics(pool.concurrency - 1);
+
+  for (size_t i = 0; i < 10; i++) {
+    *pool.Schedule(&requirements, Then([]() {}));
+  }
+
+  auto after = pool.Statistics(pool.concurrency - 1);
+
+  // The thread should have found most (if not all) of the contexts
+  // without having to park and be signalled.
+  EXPECT_GT(after.spins, before.spins);
+  EXPECT_LT(after.wakeups - before.wakeups, 10);
+}
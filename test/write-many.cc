@@ -0,0 +1,317 @@
+#include <chrono>
+#include <limits>
+#include <thread>
+
+#include "eventuals/closure.h"
+#include "eventuals/grpc/client.h"
+#include "eventuals/grpc/server.h"
+#include "eventuals/head.h"
+#include "eventuals/iterate.h"
+#include "eventuals/let.h"
+#include "eventuals/loop.h"
+#include "eventuals/map.h"
+#include "eventuals/stream.h"
+#include "eventuals/then.h"
+#include "examples/protos/keyvaluestore.grpc.pb.h"
+#include "gtest/gtest.h"
+#include "test/test.h"
+
+using stout::Borrowable;
+
+using eventuals::Closure;
+using eventuals::Head;
+using eventuals::Iterate;
+using eventuals::Let;
+using eventuals::Loop;
+using eventuals::Map;
+using eventuals::Terminate;
+using eventuals::Then;
+
+using eventuals::grpc::Client;
+using eventuals::grpc::CompletionPool;
+using eventuals::grpc::ServerBuilder;
+using eventuals::grpc::Stream;
+using eventuals::grpc::WriteBuffering;
+
+TEST_F(EventualsGrpcTest, WriteMany) {
+  ServerBuilder builder;
+
+  int port = 0;
+
+  builder.AddListeningPort(
+      "0.0.0.0:0",
+      grpc::InsecureServerCredentials(),
+      &port);
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+
+  auto server = std::move(build.server);
+
+  ASSERT_TRUE(server);
+
+  // Flush every few messages so that we get a mix of buffered and
+  // flushed writes.
+  WriteBuffering buffering;
+  buffering.messages = 8;
+
+  auto serve = [&]() {
+    return server->Accept<
+               Stream<keyvaluestore::Request>,
+               Stream<keyvaluestore::Response>>(
+               "keyvaluestore.KeyValueStore.GetValues")
+        | Head()
+        | Then(Let([&](auto& call) {
+             return call.Reader().Read()
+                 | Map([](auto&& request) {
+                      keyvaluestore::Response response;
+                      response.set_value(request.key());
+                      return response;
+                    })
+                 | StreamingEpilogue(call, buffering);
+           }));
+  };
+
+  auto [cancelled, k] = Terminate(serve());
+
+  k.Start();
+
+  Borrowable<CompletionPool> pool;
+
+  Client client(
+      "0.0.0.0:" + std::to_string(port),
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  auto call = [&]() {
+    return client.Call<
+               Stream<keyvaluestore::Request>,
+               Stream<keyvaluestore::Response>>(
+               "keyvaluestore.KeyValueStore.GetValues")
+        | Then(Let([&](auto& call) {
+             return Closure([]() {
+                      std::vector<keyvaluestore::Request> requests;
+                      for (size_t i = 0; i < 100; i++) {
+                        keyvaluestore::Request request;
+                        request.set_key(std::to_string(i));
+                        requests.push_back(request);
+                      }
+                      return Iterate(std::move(requests));
+                    })
+                 | call.Writer().WriteMany(buffering)
+                 | call.WritesDone()
+                 | Closure([&call, i = 0]() mutable {
+                      return call.Reader().Read()
+                          | Map([&i](auto&& response) {
+                               EXPECT_EQ(std::to_string(i++), response.value());
+                             })
+                          | Loop()
+                          | Then([&i]() {
+                               EXPECT_EQ(100, i);
+                             });
+                    })
+                 | call.Finish();
+           }));
+  };
+
+  auto status = *call();
+
+  EXPECT_TRUE(status.ok()) << status.error_message();
+
+  EXPECT_FALSE(cancelled.get());
+}
+
+// Tests that responses buffered by 'WriteMany()' get flushed after
+// the delay even when the stream of responses stalls, i.e., without
+// another response or 'Finish()' coming along to flush them.
+TEST_F(EventualsGrpcTest, WriteManyStalled) {
+  ServerBuilder builder;
+
+  int port = 0;
+
+  builder.AddListeningPort(
+      "0.0.0.0:0",
+      grpc::InsecureServerCredentials(),
+      &port);
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+
+  auto server = std::move(build.server);
+
+  ASSERT_TRUE(server);
+
+  // Only ever flush because of the delay.
+  WriteBuffering buffering;
+  buffering.messages = std::numeric_limits<size_t>::max();
+  buffering.bytes = std::numeric_limits<size_t>::max();
+
+  auto serve = [&]() {
+    return server->Accept<
+               Stream<keyvaluestore::Request>,
+               Stream<keyvaluestore::Response>>(
+               "keyvaluestore.KeyValueStore.GetValues")
+        | Head()
+        | Then(Let([&](auto& call) {
+             return call.Reader().Read()
+                 | Map([](auto&& request) {
+                      keyvaluestore::Response response;
+                      response.set_value(request.key());
+                      return response;
+                    })
+                 | StreamingEpilogue(call, buffering);
+           }));
+  };
+
+  auto [cancelled, k] = Terminate(serve());
+
+  k.Start();
+
+  Borrowable<CompletionPool> pool;
+
+  Client client(
+      "0.0.0.0:" + std::to_string(port),
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  auto request = [](const char* key) {
+    keyvaluestore::Request request;
+    request.set_key(key);
+    return request;
+  };
+
+  // The server's stream of responses stalls after the third one
+  // until we've received all three, so we only receive them if they
+  // get flushed after the delay.
+  auto call = [&]() {
+    return client.Call<
+               Stream<keyvaluestore::Request>,
+               Stream<keyvaluestore::Response>>(
+               "keyvaluestore.KeyValueStore.GetValues")
+        | Then(Let([&](auto& call) {
+             return call.Writer().Write(request("0"))
+                 | call.Writer().Write(request("1"))
+                 | call.Writer().Write(request("2"))
+                 | call.Reader().Read()
+                 | Head()
+                 | Then([](auto&& response) {
+                      EXPECT_EQ("0", response.value());
+                    })
+                 | call.Reader().Read()
+                 | Head()
+                 | Then([](auto&& response) {
+                      EXPECT_EQ("1", response.value());
+                    })
+                 | call.Reader().Read()
+                 | Head()
+                 | Then([](auto&& response) {
+                      EXPECT_EQ("2", response.value());
+                    })
+                 | call.WritesDone()
+                 | call.Finish();
+           }));
+  };
+
+  auto status = *call();
+
+  EXPECT_TRUE(status.ok()) << status.error_message();
+
+  EXPECT_FALSE(cancelled.get());
+}
+
+// Tests that when the stream of responses fails after 'WriteMany()'
+// has held some of them we don't write anything after the call has
+// been finished, even once the delay has expired.
+TEST_F(EventualsGrpcTest, WriteManyFail) {
+  ServerBuilder builder;
+
+  int port = 0;
+
+  builder.AddListeningPort(
+      "0.0.0.0:0",
+      grpc::InsecureServerCredentials(),
+      &port);
+
+  auto build = builder.BuildAndStart();
+
+  ASSERT_TRUE(build.status.ok());
+
+  auto server = std::move(build.server);
+
+  ASSERT_TRUE(server);
+
+  // Only ever flush because of the delay so that the last response
+  // is still being held when the stream fails.
+  WriteBuffering buffering;
+  buffering.messages = std::numeric_limits<size_t>::max();
+  buffering.bytes = std::numeric_limits<size_t>::max();
+  buffering.delay = std::chrono::milliseconds(50);
+
+  auto serve = [&]() {
+    return server->Accept<
+               Stream<keyvaluestore::Request>,
+               Stream<keyvaluestore::Response>>(
+               "keyvaluestore.KeyValueStore.GetValues")
+        | Head()
+        | Then(Let([&](auto& call) {
+             return eventuals::Stream<keyvaluestore::Response>()
+                        .raises<std::runtime_error>()
+                        .context(0)
+                        .next([](int& i, auto& k) {
+                          if (i < 3) {
+                            keyvaluestore::Response response;
+                            response.set_value(std::to_string(i++));
+                            k.Emit(std::move(response));
+                          } else {
+                            k.Fail(std::runtime_error("error"));
+                          }
+                        })
+                 | StreamingEpilogue(call, buffering);
+           }));
+  };
+
+  auto [cancelled, k] = Terminate(serve());
+
+  k.Start();
+
+  Borrowable<CompletionPool> pool;
+
+  Client client(
+      "0.0.0.0:" + std::to_string(port),
+      grpc::InsecureChannelCredentials(),
+      pool.Borrow());
+
+  auto call = [&]() {
+    return client.Call<
+               Stream<keyvaluestore::Request>,
+               Stream<keyvaluestore::Response>>(
+               "keyvaluestore.KeyValueStore.GetValues")
+        | Then(Let([&](auto& call) {
+             return call.WritesDone()
+                 | Closure([&call, i = 0]() mutable {
+                      return call.Reader().Read()
+                          | Map([&i](auto&& response) {
+                               EXPECT_EQ(std::to_string(i++), response.value());
+                             })
+                          | Loop()
+                          | Then([&i]() {
+                               EXPECT_GT(3, i);
+                             });
+                    })
+                 | call.Finish();
+           }));
+  };
+
+  auto status = *call();
+
+  EXPECT_EQ(grpc::UNKNOWN, status.error_code());
+  EXPECT_EQ("error", status.error_message());
+
+  EXPECT_FALSE(cancelled.get());
+
+  // Give the (cancelled) alarm a chance to fire after the call has
+  // been finished.
+  std::this_thread::sleep_for(buffering.delay * 2);
+}